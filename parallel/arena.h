@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <sys/mman.h>
+
+// Bump allocator for tree nodes. Nodes live in big mmap'd chunks and are
+// named by 32-bit indices (0 is null). Each thread claims a block of slots
+// at a time through its own Cursor, so allocating is a pointer bump and
+// threads only meet on one atomic add per block. T must be trivially
+// destructible: dropping the whole tree is reset(), nothing is walked.
+template <typename T>
+struct Arena
+{
+  static constexpr uint32_t chunkBits = 18; // 262144 nodes per chunk
+  static constexpr uint32_t chunkSize = UINT32_C(1) << chunkBits;
+  static constexpr uint32_t maxChunks = UINT32_C(1) << (32 - chunkBits);
+  static constexpr uint32_t blockSize = 256; // slots a cursor claims at once
+
+  // per-thread window into the arena, [next, end) is ours
+  struct Cursor
+  {
+    uint32_t next = 0;
+    uint32_t end = 0;
+  };
+
+  Arena(bool hugePages = false) : hugePages(hugePages)
+  {
+    for (uint32_t i = 0; i < maxChunks; ++i)
+      chunks[i].store(nullptr, std::memory_order_relaxed);
+  }
+  Arena(const Arena& other) = delete;
+  ~Arena()
+  {
+    for (uint32_t i = 0; i < mapped; ++i)
+      munmap(chunks[i].load(std::memory_order_relaxed), chunkBytes());
+  }
+
+  bool hugePages;
+  std::atomic<uint32_t> top = 0; // first slot no cursor has claimed
+  std::atomic<T*> chunks[maxChunks];
+  uint32_t mapped = 0; // chunks obtained from the OS, kept across resets
+  std::mutex growLock;
+
+  template <typename... Args>
+  uint32_t alloc(Cursor& cursor, Args&&... args)
+  {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "reset() never runs destructors");
+    if (cursor.next == cursor.end)
+      claim(cursor);
+    uint32_t idx = cursor.next++;
+    new (&(*this)[idx]) T(std::forward<Args>(args)...);
+    return idx;
+  }
+
+  T& operator[](uint32_t idx)
+  {
+    return chunks[idx >> chunkBits].load(std::memory_order_acquire)[idx & (chunkSize - 1)];
+  }
+  const T& operator[](uint32_t idx) const
+  {
+    return chunks[idx >> chunkBits].load(std::memory_order_acquire)[idx & (chunkSize - 1)];
+  }
+
+  // forget every node, chunks stay mapped for the next tree
+  // cursors handed out before a reset must not be used after it
+  void reset()
+  {
+    top.store(0, std::memory_order_relaxed);
+  }
+
+  // trade every node with other, O(chunks); neither may be in use
+  void swap(Arena& other)
+  {
+    uint32_t n = mapped > other.mapped ? mapped : other.mapped;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+      T* mine = chunks[i].load(std::memory_order_relaxed);
+      chunks[i].store(other.chunks[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+      other.chunks[i].store(mine, std::memory_order_relaxed);
+    }
+    uint32_t t = top.load(std::memory_order_relaxed);
+    top.store(other.top.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    other.top.store(t, std::memory_order_relaxed);
+    std::swap(mapped, other.mapped);
+    std::swap(hugePages, other.hugePages);
+  }
+
+  // slots handed to cursors, an upper bound on live nodes
+  uint32_t used() const
+  {
+    return top.load(std::memory_order_relaxed);
+  }
+
+  static constexpr size_t chunkBytes()
+  {
+    return size_t(chunkSize) * sizeof(T);
+  }
+
+private:
+  void claim(Cursor& cursor)
+  {
+    uint32_t start = top.fetch_add(blockSize, std::memory_order_relaxed);
+    // blocks never straddle chunks since blockSize divides chunkSize
+    uint32_t chunk = start >> chunkBits;
+    if (!chunks[chunk].load(std::memory_order_acquire))
+    {
+      std::lock_guard<std::mutex> guard(growLock);
+      while (mapped <= chunk)
+      {
+        void* mem = mmap(nullptr, chunkBytes(), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+          throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+        if (hugePages)
+          madvise(mem, chunkBytes(), MADV_HUGEPAGE);
+#endif
+        chunks[mapped++].store(static_cast<T*>(mem), std::memory_order_release);
+      }
+    }
+    cursor.next = start ? start : 1; // slot 0 stands for null
+    cursor.end = start + blockSize;
+  }
+};
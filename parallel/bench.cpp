@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "board.h"
+#include "mcts.h"
+#include "rollout.h"
+#include "solver.h"
+#include "xoroshiro128plus.h"
+
+// bench [--json] [--filter text] [--reps n] [--min-ms ms]
+// times the engine's hot paths, each reps times for at least min-ms, and
+// prints the median rate; --json gives the same as one JSON object
+namespace
+{
+struct Options
+{
+  bool json = false;
+  std::string filter; // only benchmarks whose name contains it
+  unsigned reps = 5;
+  double minSeconds = 0.2;
+};
+
+struct Result
+{
+  std::string name;
+  std::string unit;
+  double median, min, max; // ops per second over the reps
+};
+
+// only what runs between start() and stop() counts, setup stays outside
+struct Stopwatch
+{
+  std::chrono::steady_clock::time_point from;
+  double seconds = 0;
+
+  void start()
+  {
+    from = std::chrono::steady_clock::now();
+  }
+  void stop()
+  {
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - from).count();
+  }
+};
+
+// keeps the compiler from dropping work whose result is never used
+template <typename T>
+void keep(const T& x)
+{
+  asm volatile("" : : "g"(&x) : "memory");
+}
+
+// round(watch) does one batch of work and returns how many ops it timed
+template <typename F>
+Result measure(const std::string& name, const std::string& unit, const Options& opt, F round)
+{
+  Stopwatch warm;
+  round(warm);
+  std::vector<double> rates;
+  for (unsigned r = 0; r < opt.reps; ++r)
+  {
+    Stopwatch watch;
+    uint_fast64_t ops = 0;
+    while (watch.seconds < opt.minSeconds)
+      ops += round(watch);
+    rates.push_back(ops / watch.seconds);
+  }
+  std::sort(rates.begin(), rates.end());
+  return {name, unit, rates[rates.size() / 2], rates.front(), rates.back()};
+}
+
+// random games from a fixed seed, the same on every run
+std::vector<std::vector<uint_fast8_t>> randomGames(unsigned n)
+{
+  xoroshiro128plus prng(1);
+  std::vector<std::vector<uint_fast8_t>> games(n);
+  for (std::vector<uint_fast8_t>& game : games)
+  {
+    Board b;
+    while (!b.isDraw() && !b.isWin())
+    {
+      uint_fast8_t legal = b.legalMoves();
+      uint_fast8_t move = nthMove(legal, prng.below(moveCount(legal)));
+      b.dropPiece(move);
+      game.push_back(move);
+    }
+  }
+  return games;
+}
+
+void print(const std::vector<Result>& results, const Options& opt)
+{
+  if (!opt.json)
+  {
+    for (const Result& r : results)
+      std::cout << std::left << std::setw(28) << r.name << std::right << std::setw(14)
+                << std::fixed << std::setprecision(0) << r.median << ' ' << std::left
+                << std::setw(14) << r.unit << " min " << r.min << " max " << r.max << "\n";
+    return;
+  }
+  std::cout << std::setprecision(6) << "{\n  \"context\": {\"time\": " << std::time(nullptr)
+            << ", \"compiler\": \"" << __VERSION__ << "\", \"lanes\": " << unsigned(playoutLanes())
+            << ", \"cores\": " << std::thread::hardware_concurrency() << ", \"reps\": " << opt.reps
+            << ", \"min_ms\": " << opt.minSeconds * 1000 << "},\n  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const Result& r = results[i];
+    std::cout << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit
+              << "\", \"median\": " << r.median << ", \"min\": " << r.min << ", \"max\": " << r.max << "}";
+  }
+  std::cout << "\n  ]\n}\n";
+}
+}
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--json")
+      opt.json = true;
+    else if (arg == "--filter" && i + 1 < argc)
+      opt.filter = argv[++i];
+    else if (arg == "--reps" && i + 1 < argc)
+      opt.reps = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--min-ms" && i + 1 < argc)
+      opt.minSeconds = std::atof(argv[++i]) / 1000;
+    else
+    {
+      std::cerr << "usage: bench [--json] [--filter text] [--reps n] [--min-ms ms]\n";
+      return 1;
+    }
+  }
+
+  std::vector<Result> results;
+  auto run = [&](const std::string& name, const std::string& unit, auto round)
+  {
+    if (name.find(opt.filter) != std::string::npos)
+      results.push_back(measure(name, unit, opt, round));
+  };
+
+  const std::vector<std::vector<uint_fast8_t>> games = randomGames(1024);
+  std::vector<Board> positions; // every position of those games
+  for (const std::vector<uint_fast8_t>& game : games)
+  {
+    Board b;
+    for (uint_fast8_t move : game)
+    {
+      b.dropPiece(move);
+      positions.push_back(b);
+    }
+  }
+  Board midgame; // 12 stones, nobody has won
+  for (uint_fast8_t move : {3, 3, 3, 2, 2, 4, 4, 1, 0, 6, 5, 5})
+    midgame.dropPiece(move);
+
+  run("board/dropPiece", "drops/s", [&](Stopwatch& watch)
+  {
+    uint_fast64_t ops = 0;
+    watch.start();
+    for (const std::vector<uint_fast8_t>& game : games)
+    {
+      Board b;
+      for (uint_fast8_t move : game)
+        b.dropPiece(move);
+      keep(b.key);
+      ops += game.size();
+    }
+    watch.stop();
+    return ops;
+  });
+  run("board/isWin", "calls/s", [&](Stopwatch& watch)
+  {
+    uint_fast32_t wins = 0;
+    watch.start();
+    for (Board& b : positions)
+      wins += b.isWin();
+    watch.stop();
+    keep(wins);
+    return positions.size();
+  });
+  run("board/legalMoves", "calls/s", [&](Stopwatch& watch)
+  {
+    uint_fast32_t moves = 0;
+    watch.start();
+    for (const Board& b : positions)
+      moves += b.legalMoves();
+    watch.stop();
+    keep(moves);
+    return positions.size();
+  });
+
+  xoroshiro128plus prng(2);
+  xoroshiro128plus lanes[maxLanes];
+  for (xoroshiro128plus& lane : lanes)
+  {
+    prng.jump();
+    lane = prng;
+  }
+  for (Policy policy : {Policy::uniform, Policy::heavy})
+    for (const Board* b : {&positions[0], &midgame})
+    {
+      std::string at = std::string(policy == Policy::heavy ? "-heavy" : "") + (b == &midgame ? "/midgame" : "/opening");
+      run("rollout/scalar" + at, "games/s", [&, b, policy](Stopwatch& watch)
+      {
+        watch.start();
+        keep(playoutsScalar(*b, 4096, lanes[0], policy));
+        watch.stop();
+        return 4096;
+      });
+      run("rollout/batched" + at, "games/s", [&, b, policy](Stopwatch& watch)
+      {
+        watch.start();
+        keep(playoutsBatched(*b, 4096, lanes, policy));
+        watch.stop();
+        return 4096;
+      });
+    }
+
+  // positions the search hands to the solver at its default threshold,
+  // each round with an empty table
+  std::vector<Board> endgames;
+  for (Board& b : positions)
+    if (b.totalMoves == size - 15 && !b.isWin())
+      endgames.push_back(b);
+  for (bool weak : {true, false})
+    run(weak ? "solver/weak/15" : "solver/strong/15", "solves/s", [&](Stopwatch& watch)
+    {
+      Solver solver;
+      int_fast32_t sum = 0;
+      watch.start();
+      for (const Board& b : endgames)
+        sum += solver.solve(b, weak);
+      watch.stop();
+      keep(sum);
+      return endgames.size();
+    });
+
+  // a settled tree to walk, grown the same way every run
+  Board empty;
+  MCTS grown(empty);
+  grown.seed = 3;
+  grown.deterministic = true;
+  grown.earlyStop = false;
+  grown.run(2000, 8, 1);
+  Step path[size];
+  uint_fast8_t depth;
+  Arena<Node>::Cursor cursor;
+  // penalty 0 and the revert leave the statistics as they were, so both
+  // are timed; the first descent may attach a node, the rest reuse it
+  run("mcts/select", "selects/s", [&](Stopwatch& watch)
+  {
+    watch.start();
+    for (int i = 0; i < 1000; ++i)
+    {
+      Board b = grown.board;
+      keep(grown.select(b, path, depth, 0, cursor));
+      grown.revertVirtualLoss(path, depth, 0);
+    }
+    watch.stop();
+    return 1000;
+  });
+  Board b = grown.board;
+  grown.select(b, path, depth, 0, cursor);
+  grown.revertVirtualLoss(path, depth, 0);
+  // every reward is taken back by the next call
+  run("mcts/backpropagate", "calls/s", [&](Stopwatch& watch)
+  {
+    watch.start();
+    for (int i = 0; i < 1000; ++i)
+    {
+      grown.backpropagate(path, depth, 1, 0);
+      grown.backpropagate(path, depth, -1, 0);
+    }
+    watch.stop();
+    return 2000;
+  });
+
+  // children for positions from the recorded games, every move of each
+  // attached with all of its own; the table is cleared with the arena
+  std::vector<Board> open;
+  for (Board& b : positions)
+    if (open.size() < 4096 && !b.isWin() && !b.isDraw())
+      open.push_back(b);
+  MCTS attacher(empty);
+  run("mcts/attach", "nodes/s", [&](Stopwatch& watch)
+  {
+    attacher.nodes.reset();
+    attacher.tt.clear();
+    Arena<Node>::Cursor cursor;
+    std::vector<uint32_t> parents;
+    for (const Board& b : open)
+      parents.push_back(attacher.nodes.alloc(cursor, attacher.candidates(b)));
+    uint_fast64_t ops = 0;
+    watch.start();
+    for (size_t i = 0; i < open.size(); ++i)
+    {
+      Node* parent = &attacher.nodes[parents[i]];
+      for (uint_fast8_t slot = 0; slot < parent->count(); ++slot)
+      {
+        Board next = open[i];
+        next.dropPiece(parent->move(slot));
+        attacher.fold(next);
+        keep(attacher.attach(parent, slot, next, cursor));
+        ops++;
+      }
+    }
+    watch.stop();
+    return ops;
+  });
+
+  // the same positions valued by threat counting, all in one batch
+  std::vector<int_fast32_t> values(open.size());
+  run("eval/threats", "leaves/s", [&](Stopwatch& watch)
+  {
+    watch.start();
+    threats().evaluate(attacher, {open.data(), values.data(), uint_fast32_t(open.size()), 1, 1, nullptr});
+    watch.stop();
+    keep(values[0]);
+    return open.size();
+  });
+
+  // whole searches from the empty board, the drivers' rollout settings, a
+  // single playout per iteration where the tree dominates, and that again
+  // with leaves queued and evaluated in batches
+  for (auto [simIter, batch] : {std::pair<uint_fast32_t, uint_fast32_t>{333, 1}, {1, 1}, {1, 16}})
+  {
+    uint_fast8_t simThreads = simIter > 1 ? 3 : 1;
+    std::string name = "mcts/iteration/" + std::to_string(simIter) + "x" + std::to_string(simThreads);
+    if (batch > 1)
+      name += "/batch" + std::to_string(batch);
+    run(name, "iterations/s", [&, simIter = simIter, batch = batch](Stopwatch& watch)
+    {
+      MCTS m(empty);
+      m.seed = 4;
+      m.earlyStop = false;
+      m.batchSize = batch;
+      watch.start();
+      m.run(simIter > 1 ? 200 : 5000, simIter, simThreads);
+      watch.stop();
+      return m.iterations.load();
+    });
+  }
+
+  print(results, opt);
+  return 0;
+}
@@ -2,20 +2,51 @@
 #include <cassert>
 #include <cstdint>
 #include <iostream>
+#include <utility>
 
-Board::Board() = default;
-Board::Board(const Board& other)
-  : turn(other.turn), ogTurn(other.ogTurn), state(other.state),
-  totalMoves(other.totalMoves), lastMove(other.lastMove) , board(other.board) {}
-Board& Board::operator=(const Board& other)
+namespace
 {
-  turn = other.turn;
-  ogTurn = other.ogTurn;
-  state = other.state;
-  totalMoves = other.totalMoves;
-  lastMove = other.lastMove;
-  board = other.board;
-  return *this;
+// splitmix64, only used to fill the zobrist table at compile time
+constexpr uint64_t splitmix(uint64_t& x)
+{
+  uint64_t z = (x += UINT64_C(0x9e3779b97f4a7c15));
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
+
+struct Zobrist
+{
+  uint64_t keys[2][cols * stride]; // [turn][bit]
+};
+
+constexpr Zobrist makeZobrist()
+{
+  Zobrist z{};
+  uint64_t seed = 0xc4;
+  for (uint_fast8_t p = 0; p < 2; ++p)
+    for (uint_fast8_t i = 0; i < cols * stride; ++i)
+      z.keys[p][i] = splitmix(seed);
+  return z;
+}
+
+constexpr Zobrist zobrist = makeZobrist();
+
+constexpr uint64_t gather()
+{
+  uint64_t m = 0;
+  for (uint_fast8_t c = 0; c < cols; ++c)
+    m |= UINT64_C(1) << (stride - 1) * (cols - 1 - c);
+  return m;
+}
+
+constexpr uint64_t topRow()
+{
+  uint64_t m = 0;
+  for (uint_fast8_t c = 0; c < cols; ++c)
+    m |= topMask(c);
+  return m;
+}
 }
 
 void Board::printBoard()
@@ -28,25 +59,39 @@ void Board::printBoard()
   }
   std::cout << "\n";
 }
-// guaranteed no error, get moves from getLegalMoves
+
+// guaranteed no error, get moves from legalMove
 void Board::dropPiece(int_fast8_t col)
 {
-  for (;;)
+  assert(legalMove(col)); // if not column full
+  key ^= zobrist.keys[turn][col * stride + heights[col]];
+  mirrorKey ^= zobrist.keys[turn][(cols - 1 - col) * stride + heights[col]];
+  current ^= mask; // hand the stones over to the opponent
+  mask |= mask + bottomMask(col); // carry lands on the first empty cell
+  heights[col]++;
+  totalMoves++;
+  lastMove = col;
+  state = turn == ogTurn ? 1 : -1;
+  turn = !turn;
+}
+
+void Board::mirror()
+{
+  const uint64_t column = (UINT64_C(1) << stride) - 1;
+  uint64_t c = 0, m = 0;
+  for (uint_fast8_t col = 0; col < cols; ++col)
   {
-    assert(col+35 >= 0); // if not column full
-    if (getPiece(col+35) == 0)
-    {
-      totalMoves++;
-      board[(col+35)*2] = !turn ? 0 : 1;
-      board[(col+35)*2+1] = !turn ? 1 : 0;
-      lastMove = col+35;
-      state = turn == ogTurn ? 1 : -1;
-      turn = !turn;
-      return;
-    }
-    col -= cols;
+    const uint_fast8_t to = (cols - 1 - col) * stride;
+    c |= (current >> col * stride & column) << to;
+    m |= (mask >> col * stride & column) << to;
   }
-  assert(false); // something went wrong
+  current = c;
+  mask = m;
+  for (uint_fast8_t col = 0; col < cols / 2; ++col)
+    std::swap(heights[col], heights[cols - 1 - col]);
+  std::swap(key, mirrorKey);
+  if (lastMove < cols)
+    lastMove = cols - 1 - lastMove;
 }
 
 bool Board::isDraw()
@@ -61,53 +106,38 @@ bool Board::isDraw()
 // false => spot taken
 bool Board::legalMove(uint_fast8_t move)
 {
-  return !getPiece(move);
-}
-
-bool Board::validIndex(int_fast8_t dx, int_fast8_t dy)
-{
-  int_fast8_t move = (lastMove / cols + dx) * cols + ((lastMove % cols) + dy);
-  bool cond = getPiece(move) == getPiece(lastMove) && move > 0;
-  if (dx && dy)
-  {
-    return cond && move / cols - dx == lastMove / cols
-                && (move % cols) - dy == lastMove % cols;
-  }
-  else if (!dx && dy)
-  {
-    return cond && move / cols == lastMove / cols;
-  }
-  else // dx && !dy
-  {
-    return cond && move % cols == lastMove % cols;
-  }
+  return !(mask & topMask(move));
 }
 
-bool Board::checkConsecutive(int_fast8_t dx, int_fast8_t dy)
+uint_fast8_t Board::legalMoves() const
 {
-  uint_fast8_t total = 1;
-  auto consec = [this, &total](int_fast8_t dx, int_fast8_t dy)
-  {
-    for (int_fast8_t cnt = 1, ndx = dx, ndy = dy;
-         cnt < 4 && validIndex(ndx, ndy);
-         ndx += dx, ndy += dy, cnt++)
-    total++;
-  };
-  consec(dx, dy);
-  if (total > 3) return true;
-  consec(-dx, -dy);
-  return total > 3;
+  // the top cells sit stride apart, one multiply slides column c's bit up
+  // to 42 + c; no two partial products share a bit, so nothing carries
+  const uint64_t open = (~mask & topRow()) >> (rows - 1);
+  return open * gather() >> (stride - 1) * (cols - 1) & ((1 << cols) - 1);
 }
 
 bool Board::isWin()
 {
-  return checkConsecutive(0, 1) || checkConsecutive(1, 0) ||
-         checkConsecutive(1, 1) || checkConsecutive(-1, 1);
+  const uint64_t pos = current ^ mask; // whoever moved last
+  uint64_t m = pos & (pos >> stride); // horizontal
+  if (m & (m >> (2 * stride)))
+    return true;
+  m = pos & (pos >> (stride - 1)); // diagonal
+  if (m & (m >> (2 * (stride - 1))))
+    return true;
+  m = pos & (pos >> (stride + 1)); // anti-diagonal
+  if (m & (m >> (2 * (stride + 1))))
+    return true;
+  m = pos & (pos >> 1); // vertical
+  return m & (m >> 2);
 }
 
-// index 0-41
-int_fast8_t Board::getPiece(uint_fast8_t idx, int_fast8_t dx, int_fast8_t dy)
+int_fast8_t Board::getPiece(uint_fast8_t idx)
 {
-  int_fast8_t newIdx = ((idx / cols + dx) * cols + ((idx % cols) + dy));
-  return (board[newIdx * 2] << 1) + board[newIdx * 2 + 1];
+  const uint64_t bit = UINT64_C(1) << ((idx % cols) * stride + rows - 1 - idx / cols);
+  if (!(mask & bit))
+    return 0;
+  const uint64_t first = turn ? current ^ mask : current;
+  return first & bit ? 1 : 2;
 }
@@ -1,17 +1,149 @@
 #pragma once
 
 #include <cstdint>
-#include <bitset>
 
 constexpr uint_fast8_t size = 42;
 constexpr uint_fast8_t rows = 6;
 constexpr uint_fast8_t cols = 7;
+constexpr uint_fast8_t stride = rows + 1; // bits per column, top one is a sentinel
+
+// bit (col * stride + row) is the cell at col, counting rows from the bottom
+constexpr uint64_t bottomMask(uint_fast8_t col)
+{
+  return UINT64_C(1) << (col * stride);
+}
+constexpr uint64_t topMask(uint_fast8_t col)
+{
+  return UINT64_C(1) << (col * stride + rows - 1);
+}
+
+constexpr uint64_t bottomRow()
+{
+  uint64_t m = 0;
+  for (uint_fast8_t c = 0; c < cols; ++c)
+    m |= bottomMask(c);
+  return m;
+}
+
+inline constexpr uint64_t bottom = bottomRow(); // the lowest cell of every column
+inline constexpr uint64_t playable = bottom * ((UINT64_C(1) << rows) - 1); // every cell but the sentinels
+
+// the cells of column col
+constexpr uint64_t columnMask(uint_fast8_t col)
+{
+  return ((UINT64_C(1) << rows) - 1) << col * stride;
+}
+
+// the cell each open column would take next, the carry of the add lands
+// on the first empty cell
+inline uint64_t landing(uint64_t mask)
+{
+  return (mask + bottom) & playable;
+}
+
+// cells that complete four along direction s: next to three stones on
+// either side, or filling the gap of three with one missing
+inline uint64_t alignedCells(uint64_t position, uint_fast8_t s)
+{
+  uint64_t p = (position << s) & (position << 2 * s);
+  uint64_t r = p & (position << 3 * s);
+  r |= p & (position >> s);
+  p = (position >> s) & (position >> 2 * s);
+  r |= p & (position << s);
+  return r | (p & (position >> 3 * s));
+}
+
+// empty cells that would complete four for the stones in position, inline
+// so the rollout kernels can run it once per vector lane
+inline uint64_t winningCells(uint64_t position, uint64_t mask)
+{
+  uint64_t r = (position << 1) & (position << 2) & (position << 3); // vertical
+  r |= alignedCells(position, stride) | alignedCells(position, stride - 1) | alignedCells(position, stride + 1);
+  return r & (playable ^ mask);
+}
+
+// the cells of land, where the stones of each open column would land,
+// sorted the way the heavy rollouts and the search's pruning pick moves
+struct LandingCells
+{
+  uint64_t wins; // four for the player to move
+  uint64_t forced; // blocks of the opponent's four
+  uint64_t safe; // not right under one of the opponent's winning cells
+};
+
+inline LandingCells classifyLanding(uint64_t current, uint64_t mask, uint64_t land)
+{
+  const uint64_t threats = winningCells(current ^ mask, mask);
+  return {winningCells(current, mask) & land, threats & land, land & ~(threats >> 1)};
+}
+
+// bit c set when cells has one in column c
+inline uint_fast8_t columnsOf(uint64_t cells)
+{
+  uint_fast8_t m = 0;
+  for (uint_fast8_t col = 0; col < cols; ++col)
+    m |= uint_fast8_t((cells & columnMask(col)) != 0) << col;
+  return m;
+}
+
+constexpr uint_fast8_t centreOrder[cols] = {3, 2, 4, 1, 5, 0, 6}; // centre first
+
+// lookups for sets of columns, one bit per column: popcount and the k-th
+// set bit, so a uniform pick among the legal moves never branches, and the
+// k-th counting out from the centre, the order the search keeps moves in
+struct MoveTables
+{
+  uint_fast8_t count[1 << cols];
+  uint_fast8_t nth[1 << cols][cols];
+  uint_fast8_t centre[1 << cols][cols];
+  uint_fast8_t before[cols]; // the columns nearer the centre than each
+};
+
+constexpr MoveTables makeMoveTables()
+{
+  MoveTables t{};
+  for (uint_fast8_t m = 0; m < (1 << cols); ++m)
+  {
+    for (uint_fast8_t c = 0; c < cols; ++c)
+      if (m >> c & 1)
+        t.nth[m][t.count[m]++] = c;
+    uint_fast8_t k = 0;
+    for (uint_fast8_t c : centreOrder)
+      if (m >> c & 1)
+        t.centre[m][k++] = c;
+  }
+  for (uint_fast8_t i = 1; i < cols; ++i)
+    t.before[centreOrder[i]] = t.before[centreOrder[i - 1]] | 1 << centreOrder[i - 1];
+  return t;
+}
+
+inline constexpr MoveTables moveTables = makeMoveTables();
+
+inline uint_fast8_t moveCount(uint_fast8_t moves)
+{
+  return moveTables.count[moves];
+}
+// the k-th lowest column set in moves, k < moveCount(moves)
+inline uint_fast8_t nthMove(uint_fast8_t moves, uint_fast8_t k)
+{
+  return moveTables.nth[moves][k];
+}
+// the k-th column set in moves counting out from the centre
+inline uint_fast8_t nthFromCentre(uint_fast8_t moves, uint_fast8_t k)
+{
+  return moveTables.centre[moves][k];
+}
+// where col, which moves has, comes in moves counting out from the centre
+inline uint_fast8_t centreRank(uint_fast8_t moves, uint_fast8_t col)
+{
+  return moveTables.count[moves & moveTables.before[col]];
+}
 
 struct Board
 {
-  Board();
-  Board(const Board& other);
-  Board& operator=(const Board& other);
+  Board() = default;
+  Board(const Board& other) = default;
+  Board& operator=(const Board& other) = default;
   ~Board() = default;
 
   bool turn = false;
@@ -19,20 +151,25 @@ struct Board
 
   int_fast8_t state = 0; // 1 is win, 0 is draw, -1 is loss
   uint_fast8_t totalMoves = 0;
-  uint_fast8_t lastMove = -1; // will have been done by !turn
-  std::bitset<84> board;
+  uint_fast8_t lastMove = -1; // column, will have been done by !turn
+  uint64_t current = 0; // stones of the player to move
+  uint64_t mask = 0; // every occupied cell
+  uint_fast8_t heights[cols] = {}; // stones in each column
+  uint64_t key = 0; // zobrist hash of the stones, 0 for the empty board
+  uint64_t mirrorKey = 0; // key of the position reflected left to right
 
   void printBoard();
   void dropPiece(int_fast8_t col);
+  // reflects the stones left to right, keys and all
+  void mirror();
 
-  // iterates through first row of bitset
-  // checks whether all bits are taken or not
   bool isDraw();
   bool legalMove(uint_fast8_t move);
-  bool validIndex(int_fast8_t dx, int_fast8_t dy);
-  bool checkConsecutive(int_fast8_t dx, int_fast8_t dy);
-  // checks 4-in-a-row from most recent move
+  // bit c set when column c has room, from one mask test for all of them
+  uint_fast8_t legalMoves() const;
+  // checks 4-in-a-row for the player who just moved
   bool isWin();
 
-  int_fast8_t getPiece(uint_fast8_t idx, int_fast8_t dx = 0, int_fast8_t dy = 0);
+  // index 0-41, row-major from the top left; 0 empty, 1 first player, 2 second
+  int_fast8_t getPiece(uint_fast8_t idx);
 };
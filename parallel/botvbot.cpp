@@ -1,26 +1,47 @@
+#include <chrono>
+#include <iostream>
+#include <string>
 #include "board.h"
 #include "mcts.h"
 
-int main()
+// botvbot [ensemble] [stats]: ensemble picks how the engine uses its
+// threads, stats prints each search's statistics as a line of JSON (they
+// are only collected when built with CONNECT4_STATS)
+int main(int argc, char** argv)
 {
+  bool ensemble = false, stats = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    ensemble |= std::string(argv[i]) == "ensemble";
+    stats |= std::string(argv[i]) == "stats";
+  }
   for (int i = 0; i < 100; ++i)
   {
     Board b;
+    auto start = std::chrono::steady_clock::now();
+    MCTS m(b); // one tree for the game, re-rooted after every move
+    if (ensemble)
+      m.mode = Parallelism::ensemble;
     do
     {
-      MCTS m(b);
-      uint_fast8_t move = m.run(5000, 333, 3);
+      uint_fast8_t move = m.run(5000, 100, 3);
+      if (stats)
+        std::cout << m.stats.json() << "\n";
       b.dropPiece(move);
+      m.advance(move);
       //b.printBoard();
     }
     while (!b.isDraw() && !b.isWin());
     b.printBoard();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Game " << i << ": " << (unsigned) b.totalMoves << " moves, "
+              << m.playouts / secs << " playouts/s\n\n";
   }
   return 0;
 }
 
 // Uncomment printBT if you want to see the Tree after each run
-//printT(m.root);
+//printT(m.nodes, m.root);
 //std::cout << "Move " << (int) move << "\n";
 //std::cout << "Turn " << b.turn << "\n";
 //std::cout << "Created " << m.createdNodes << "\n";
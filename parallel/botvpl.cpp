@@ -1,28 +1,46 @@
 #include "mcts.h"
 #include "board.h"
+#include "timeman.h"
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 
-int main()
+// botvpl [seconds] plays each game on a clock of that many seconds,
+// otherwise every move gets a fixed number of iterations
+int main(int argc, char** argv)
 {
+  double clock = argc > 1 ? std::atof(argv[1]) : 0;
   while (1)
   {
     int move;
     Board b;
+    MCTS m(b); // kept for the whole game, re-rooted after every move
+    TimeManager tm(std::chrono::milliseconds(static_cast<int_fast64_t>(clock * 1000)));
     do
     {
       std::cin >> move;
       b.dropPiece(move);
+      m.advance(move);
       b.printBoard();
 
       if (b.isWin() || b.isDraw())
         break;
 
-      MCTS m(b);
-      move = m.run(5000, 333, 3);
+      if (clock > 0)
+      {
+        auto start = std::chrono::steady_clock::now();
+        move = m.runFor(tm.allot(b.totalMoves), 100, 3);
+        tm.spent(std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start));
+      }
+      else
+        move = m.run(5000, 100, 3);
       b.dropPiece(move);
+      m.advance(move);
       b.printBoard();
+      m.ponder(100, 3); // think on the player's time
     }
-    while (!b.isDraw() && !b.isWin());
+    while (!b.isWin() && !b.isDraw()); // a win on the last cell is a win
     std::cout << (b.state == 1 ? "Nice!\n\n" : "Aww man!\n\n");
   }
 
@@ -0,0 +1,85 @@
+#include <cmath>
+#include <cstdint>
+
+#include "elo.h"
+
+namespace
+{
+double expected(double elo)
+{
+  return 1 / (1 + std::pow(10, -elo / 400));
+}
+
+double eloOf(double points)
+{
+  return -400 * std::log10(1 / points - 1);
+}
+}
+
+uint_fast32_t Score::games() const
+{
+  return wins + draws + losses;
+}
+
+double Score::points() const
+{
+  return games() ? (wins + 0.5 * draws) / games() : 0.5;
+}
+
+double Score::variance() const
+{
+  if (!games())
+    return 0;
+  double p = points();
+  return (wins * (1 - p) * (1 - p) + draws * (0.5 - p) * (0.5 - p) + losses * p * p) / games();
+}
+
+double Score::elo() const
+{
+  return eloOf(points());
+}
+
+double Score::eloMargin() const
+{
+  if (!games())
+    return INFINITY;
+  double spread = 1.959964 * std::sqrt(variance() / games());
+  double low = points() - spread;
+  double high = points() + spread;
+  if (low <= 0 || high >= 1)
+    return INFINITY;
+  return (eloOf(high) - eloOf(low)) / 2;
+}
+
+double Score::llr(double elo0, double elo1) const
+{
+  if (!games())
+    return 0;
+  double var = variance();
+  if (var <= 0) // every game went the same way, borrow a win and a loss
+  {
+    Score padded = *this;
+    padded.wins++;
+    padded.losses++;
+    var = padded.variance();
+  }
+  double s0 = expected(elo0);
+  double s1 = expected(elo1);
+  return games() * (s1 - s0) * (2 * points() - s0 - s1) / (2 * var);
+}
+
+double Sprt::lower() const
+{
+  return std::log(beta / (1 - alpha));
+}
+
+double Sprt::upper() const
+{
+  return std::log((1 - beta) / alpha);
+}
+
+int_fast8_t Sprt::verdict(const Score& score) const
+{
+  double l = score.llr(elo0, elo1);
+  return l >= upper() ? 1 : l <= lower() ? -1 : 0;
+}
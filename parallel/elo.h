@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// one engine's results against another, from the first engine's side
+struct Score
+{
+  uint_fast32_t wins = 0;
+  uint_fast32_t draws = 0;
+  uint_fast32_t losses = 0;
+
+  uint_fast32_t games() const;
+  // mean points per game, a draw is half a point
+  double points() const;
+  // of one game's points around points()
+  double variance() const;
+  // rating difference the points imply on the logistic Elo scale
+  double elo() const;
+  // half the width of the 95% confidence interval of elo()
+  double eloMargin() const;
+  // log likelihood ratio of elo1 against elo0, from the normal
+  // approximation of the game results
+  double llr(double elo0, double elo1) const;
+};
+
+// sequential probability ratio test between H0: elo0 and H1: elo1, alpha
+// and beta are the rates of false positives and false negatives
+struct Sprt
+{
+  double elo0;
+  double elo1;
+  double alpha = 0.05;
+  double beta = 0.05;
+
+  double lower() const;
+  double upper() const;
+  // -1 accepts H0, 1 accepts H1, 0 keeps playing
+  int_fast8_t verdict(const Score& score) const;
+};
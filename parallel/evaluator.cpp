@@ -0,0 +1,138 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "evaluator.h"
+#include "mcts.h"
+#include "rollout.h"
+
+// every batch of every leaf goes to the pool before any is waited for, so
+// the leaves play out side by side; a batch's sum lands in its own cell
+void RolloutEvaluator::evaluate(MCTS& search, const Batch& batch)
+{
+  const uint_fast32_t jobs = batch.size * batch.simThreads;
+  std::vector<int_fast32_t> sums(jobs);
+  std::atomic<uint_fast32_t> pending = jobs;
+  for (uint_fast32_t j = 0; j < jobs; ++j)
+  {
+    search.pool->submit([&search, &batch, &sums, j, lanes = batch.rollouts + j * maxLanes]()
+    {
+      const Board& b = batch.boards[j / batch.simThreads];
+      int_fast32_t s = 0;
+      uint_fast32_t done = 0;
+      while (done < batch.simIter)
+      {
+        if (std::chrono::steady_clock::now() >= search.deadline)
+          search.stop = true;
+        if (search.stopped())
+          break; // the caller throws a cut short batch away
+        uint_fast32_t games = batch.simIter - done < 64 ? batch.simIter - done : 64;
+        s += search.batchedRollouts ? playoutsBatched(b, games, lanes, search.policy)
+                                    : playoutsScalar(b, games, lanes[0], search.policy);
+        done += games;
+      }
+      sums[j] = s;
+      search.playouts += done;
+    }, pending);
+  }
+  search.pool->wait(pending);
+
+  for (uint_fast32_t i = 0; i < batch.size; ++i)
+  {
+    int_fast32_t score = 0;
+    for (uint_fast8_t t = 0; t < batch.simThreads; ++t)
+      score += sums[i * batch.simThreads + t];
+    batch.values[i] = score;
+  }
+}
+
+namespace
+{
+// the rows each player's zugzwang claims, counted from the bottom: the
+// first player's threats on the 1st, 3rd and 5th, the second's on the rest
+constexpr uint64_t oddRows = bottom * 0b010101;
+constexpr uint64_t evenRows = bottom * 0b101010;
+
+// cells by how many lines of four pass through them, 3 in the corners to
+// 13 in the middle; a stone counts that many times
+constexpr uint_fast8_t maxLines = 13;
+
+struct LineMasks
+{
+  uint64_t cells[maxLines + 1] = {};
+};
+
+constexpr LineMasks makeLineMasks()
+{
+  LineMasks t{};
+  const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+  for (int c = 0; c < cols; ++c)
+    for (int r = 0; r < rows; ++r)
+    {
+      uint_fast8_t lines = 0;
+      for (const auto& d : dirs)
+        for (int back = 0; back < 4; ++back) // where the cell sits in the four
+        {
+          const int c0 = c - back * d[0], r0 = r - back * d[1];
+          const int c3 = c0 + 3 * d[0], r3 = r0 + 3 * d[1];
+          lines += c0 >= 0 && c0 < cols && r0 >= 0 && r0 < rows && c3 >= 0 && c3 < cols && r3 >= 0 && r3 < rows;
+        }
+      t.cells[lines] |= UINT64_C(1) << (c * stride + r);
+    }
+  return t;
+}
+
+constexpr LineMasks lineMasks = makeLineMasks();
+
+int lines(uint64_t stones)
+{
+  int sum = 0;
+  for (uint_fast8_t n = 3; n <= maxLines; ++n)
+    sum += n * __builtin_popcountll(stones & lineMasks.cells[n]);
+  return sum;
+}
+
+// in (-1, 1) for the player to move, 1 and -1 when the result is certain
+float threatValue(const Board& b)
+{
+  const uint64_t them = b.current ^ b.mask;
+  const uint64_t land = landing(b.mask);
+  const uint64_t mine = winningCells(b.current, b.mask);
+  const uint64_t theirs = winningCells(them, b.mask);
+  if (mine & land)
+    return 1;
+  if (__builtin_popcountll(theirs & land) > 1) // only one can be blocked
+    return -1;
+  const bool first = !(b.totalMoves & 1);
+  const int threats = __builtin_popcountll(mine) + __builtin_popcountll(mine & (first ? oddRows : evenRows))
+                    - __builtin_popcountll(theirs) - __builtin_popcountll(theirs & (first ? evenRows : oddRows));
+  // a threat is worth about a centre stone over an edge one
+  const float score = threats + (lines(b.current) - lines(them)) / 8.0f;
+  return score / (std::abs(score) + 4);
+}
+}
+
+void ThreatEvaluator::evaluate(MCTS&, const Batch& batch)
+{
+  const float scale = float(batch.simIter) * batch.simThreads;
+  for (uint_fast32_t i = 0; i < batch.size; ++i)
+  {
+    const Board& b = batch.boards[i];
+    const float value = threatValue(b) * scale;
+    batch.values[i] = int_fast32_t(std::lround(b.turn == b.ogTurn ? value : -value));
+  }
+}
+
+Evaluator& rollouts()
+{
+  static RolloutEvaluator evaluator;
+  return evaluator;
+}
+
+Evaluator& threats()
+{
+  static ThreatEvaluator evaluator;
+  return evaluator;
+}
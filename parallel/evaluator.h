@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include "board.h"
+#include "xoroshiro128plus.h"
+
+struct MCTS;
+
+// one batch of leaves for an evaluator to value, and what it may spend
+struct Batch
+{
+  const Board* boards;
+  // one per board, from the side of its ogTurn like a rollout's result:
+  // simIter * simThreads for a certain win, the negative for a loss
+  int_fast32_t* values;
+  uint_fast32_t size;
+  uint_fast32_t simIter; // playouts per rollout batch
+  uint_fast8_t simThreads; // rollout batches per leaf
+  // simThreads * maxLanes streams per leaf, leaf i's start at
+  // i * simThreads * maxLanes
+  xoroshiro128plus* rollouts;
+};
+
+// Values the leaves the search reaches. The search hands over as many
+// leaves at once as MCTS::batchSize allows, so an evaluator that works on
+// many positions together, a vectorised or a network one, gets them
+// together. Called by every worker at once, so anything it keeps must be
+// read only; it may stop early once search.stopped(), the search then
+// throws the whole batch away.
+struct Evaluator
+{
+  virtual ~Evaluator() = default;
+  virtual void evaluate(MCTS& search, const Batch& batch) = 0;
+};
+
+// simIter playouts in each of simThreads batches on the search's pool,
+// picked by its policy, for every leaf of the batch at once
+struct RolloutEvaluator : Evaluator
+{
+  void evaluate(MCTS& search, const Batch& batch) override;
+};
+
+// no playouts, a guess from the board: an immediate win, two wins for the
+// opponent, and otherwise the difference in cells that would complete
+// four, doubled on the rows a player's zugzwang claims, plus each stone
+// weighted by the lines of four through its cell. Its values are whole
+// playouts, so it needs simIter * simThreads well above 1 to tell
+// positions apart, which costs it nothing
+struct ThreatEvaluator : Evaluator
+{
+  void evaluate(MCTS& search, const Batch& batch) override;
+};
+
+// process-wide instances, they keep nothing between calls
+Evaluator& rollouts();
+Evaluator& threats();
@@ -1,254 +1,763 @@
 #include <atomic>
-#include <cassert>
 #include <cmath>
 #include <cstdint>
-#include <iostream>
+#include <random>
 #include <thread>
 
 #include "mcts.h"
-#include "printtree.h"
+#include "threadpool.h"
 #include "xoroshiro128plus.h"
 
-Node::Node() = default;
+Node::Node(uint_fast8_t legal) : legal(legal) {}
 
-Node::Node(const Board& board) : b(board) {}
-
-Node::Node(const Node* other) : root(other->root), terminal(other->terminal),
-    expanded(other->expanded), UCT(other->UCT), inserted(other->inserted),
-    score(other->score), visits(other->visits)
+Node::Node(const Node& other) : total(other.total.load()), legal(other.legal)
 {
   for (uint_fast8_t i = 0; i < cols; ++i)
   {
-    if (children[i])
-      delete children[i];
-    children[i] = other->children[i];
-    moves[i] = other->moves[i];
+    children[i] = other.children[i].load();
+    visits[i] = other.visits[i].load();
+    scores[i] = other.scores[i].load();
+    proofs[i] = other.proofs[i].load();
   }
 }
 
-Node::~Node()
+Pending::Pending(uint_fast32_t batchSize) : leaves(batchSize), boards(batchSize), values(batchSize) {}
+
+Streams::Streams(const xoroshiro128plus& search, unsigned worker, uint_fast32_t batches)
+  : rollouts(batches * maxLanes)
 {
-  for (uint_fast8_t i = 0; i < cols; ++i)
+  xoroshiro128plus next = search;
+  for (unsigned i = 0; i <= worker; ++i)
+    next.long_jump();
+  for (xoroshiro128plus& lane : rollouts)
   {
-    if (children[i])
-      delete children[i];
+    next.jump();
+    lane = next;
   }
 }
 
-
-MCTS::MCTS(Board& b)
+MCTS::MCTS(Board& b) : nodes(true), spare(true), board(b),
+    seed(uint64_t(std::random_device{}()) << 32 | std::random_device{}())
 {
-  root = new Node(b);
-  root->visits++;
+  Arena<Node>::Cursor cursor;
+  root = nodes.alloc(cursor, b.legalMoves());
 }
 
+// the arena unmaps its chunks, no per-node teardown
 MCTS::~MCTS()
 {
-  delete root;
+  stopPondering();
 }
 
-Node* MCTS::select(Node* node, Node*& spare)
+bool MCTS::select(Board& b, Step* path, uint_fast8_t& depth, int_fast32_t penalty, Arena<Node>::Cursor& cursor)
 {
-  if (!node->expanded)
-    return node;
+  switch (exploration)
+  {
+  case Exploration::ucb1Tuned:
+    return descend<UCB1Tuned>(b, path, depth, penalty, cursor);
+  case Exploration::puct:
+    return descend<PUCT>(b, path, depth, penalty, cursor);
+  default:
+    return descend<UCB1>(b, path, depth, penalty, cursor);
+  }
+}
 
-  float UCT;
-  //Node* temproot = node;
-  while (node->expanded) // this is nullptr, better conditionals
+template <class Formula>
+bool MCTS::descend(Board& b, Step* path, uint_fast8_t& depth, int_fast32_t penalty, Arena<Node>::Cursor& cursor)
+{
+  depth = 0;
+  uint32_t idx = root;
+  for (;;)
   {
-    Node* best;
-    UCT = -INFINITY;
-    for (uint_fast8_t i = 0; i < cols; ++i)
+    Node* node = &nodes[idx];
+    uint_fast8_t slot = bestChild<Formula>(node, node->total.load(std::memory_order_relaxed) + 1, penalty);
+    const bool fresh = !addVirtualLoss(node, slot, penalty);
+    path[depth++] = {idx, slot};
+    if (node->proofs[slot].load(std::memory_order_relaxed) != Proof::unknown)
+      return false; // nothing under a proven move changes its result
+
+    // the child's two lines load while the board catches up
+    uint32_t child = node->children[slot].load(std::memory_order_acquire);
+    if (child)
     {
-      if (!node->children[i]->terminal)
-      {
-        if (UCT < node->children[i]->UCT)
-        {
-          best = node->children[i];
-          UCT = node->children[i]->UCT;
-        }
-      }
+      const char* next = reinterpret_cast<const char*>(&nodes[child]);
+      __builtin_prefetch(next);
+      __builtin_prefetch(next + 64);
     }
-    if (UCT == -INFINITY) // case where all children are terminal, skip to backpropagation
+    b.dropPiece(node->move(slot));
+    // a move with visits but no child may be one another worker made
+    // first and is still proving
+    if (fresh || (!child && solvable(b)))
+      return true;
+    fold(b);
+    idx = child ? child : attach(node, slot, b, cursor);
+  }
+}
+
+bool MCTS::fold(Board& b)
+{
+  if (!mirror || b.mirrorKey >= b.key)
+    return false;
+  b.mirror();
+  return true;
+}
+
+uint_fast8_t MCTS::distinct(const Board& b)
+{
+  const uint_fast8_t legal = b.legalMoves();
+  return mirror && b.key == b.mirrorKey ? legal & ((1 << (cols / 2 + 1)) - 1) : legal;
+}
+
+uint_fast8_t MCTS::candidates(const Board& b)
+{
+  const uint_fast8_t moves = distinct(b);
+  if (!prune)
+    return moves;
+  const LandingCells cells = classifyLanding(b.current, b.mask, landing(b.mask));
+  const uint_fast8_t wins = columnsOf(cells.wins) & moves;
+  if (wins) // one is enough
+    return wins & -wins;
+  const uint_fast8_t forced = columnsOf(cells.forced) & moves;
+  if (forced)
+    return forced;
+  const uint_fast8_t safe = columnsOf(cells.safe) & moves;
+  return safe ? safe : moves;
+}
+
+bool MCTS::solvable(Board& b)
+{
+  return b.isWin() || b.totalMoves == size || size - b.totalMoves < solveBelow;
+}
+
+uint32_t MCTS::attach(Node* parent, uint_fast8_t slot, const Board& b, Arena<Node>::Cursor& cursor)
+{
+  uint32_t idx = useTT && b.key ? tt.lookup(b.key) : 0;
+  if (!idx)
+  {
+    idx = nodes.alloc(cursor, candidates(b));
+    made.fetch_add(1, std::memory_order_relaxed);
+    if (useTT && b.key)
     {
-      spare = node;
-      return nullptr;
+      uint32_t owner = tt.insert(b.key, idx);
+      if (owner) // ours is garbage if someone else's went in first
+        idx = owner;
     }
+  }
+  uint32_t seen = 0;
+  if (!parent->children[slot].compare_exchange_strong(seen, idx, std::memory_order_acq_rel))
+    idx = seen; // another worker attached one first
+  return idx;
+}
 
+int_fast8_t MCTS::prove(Node* node, uint_fast8_t slot, Board& b)
+{
+  int_fast8_t result = b.isWin() ? 1 : b.totalMoves == size ? 0 : -solver.solve(b, true);
+  node->proofs[slot].store(Proof(result + 2), std::memory_order_relaxed);
+  return result;
+}
+
+int_fast32_t MCTS::reward(uint_fast8_t depth, int_fast8_t result, int_fast32_t penalty)
+{
+  bool second = board.turn != bool((depth - 1) & 1);
+  return (second ? -result : result) * penalty;
+}
+
+// the evaluator sees the boards alone, the paths stay here
+bool MCTS::evaluate(Pending& pending, uint_fast32_t simIter, uint_fast8_t simThreads, Streams& rng, PhaseStats& stats)
+{
+  const int_fast32_t penalty = simIter * simThreads;
+  for (uint_fast32_t i = 0; i < pending.size; ++i)
+    pending.boards[i] = pending.leaves[i].board;
+  evaluator->evaluate(*this, {pending.boards.data(), pending.values.data(), pending.size, simIter, simThreads,
+                              rng.rollouts.data()});
+  stats.lap(Phase::simulate);
+  const bool kept = !stopped();
+  for (uint_fast32_t i = 0; i < pending.size; ++i)
+  {
+    const Leaf& leaf = pending.leaves[i];
+    if (!kept)
+      revertVirtualLoss(leaf.path, leaf.depth, penalty);
     else
-      node = best;
+    {
+      backpropagate(leaf.path, leaf.depth, pending.values[i], penalty);
+      stats.leaf(leaf.depth, penalty);
+    }
   }
-  //if (UCT == -INFINITY || node->terminal)
-  //{
-  //  spare = node;
-  //  return nullptr;
-  //}
-  if (node->terminal || node->expanded)
+  if (kept)
+    stats.lap(Phase::backpropagate);
+  pending.size = 0;
+  return kept;
+}
+
+template <class Formula>
+uint_fast8_t MCTS::bestChild(const Node* node, uint_fast32_t parentVisits, int_fast32_t penalty)
+{
+  // gather the slots into lanes, padded to a full vector; the atomics
+  // keep this part scalar, so it also takes the early answers
+  constexpr uint_fast8_t lanes = 8;
+  const uint_fast8_t count = node->count();
+  alignas(32) float mean[lanes] = {}, rsqrt[lanes] = {}, floor[lanes];
+  uint_fast8_t lost = cols;
+  for (uint_fast8_t i = 0; i < lanes; ++i)
+    floor[i] = -INFINITY;
+  for (uint_fast8_t i = 0; i < count; ++i)
   {
-    std::cout << "Term " << node->terminal << " exp " << node->expanded << "\n";
-    printT(root);
-    printT(node);
-    node->b.printBoard();
-    assert(false);
+    Proof proof = node->proofs[i].load(std::memory_order_relaxed);
+    if (proof == Proof::win)
+      return i;
+    if (proof == Proof::loss)
+    {
+      lost = i;
+      continue;
+    }
+    uint_fast32_t v = node->visits[i].load(std::memory_order_relaxed);
+    if (!v)
+      return i;
+    rsqrt[i] = rsqrtOf(v);
+    mean[i] = float(node->scores[i].load(std::memory_order_relaxed)) * rsqrt[i] * rsqrt[i];
+    floor[i] = 0;
   }
-  return node;
+
+  // every lane scored and the first best found without a branch
+  const UctContext ctx = Formula::start(EXPL, parentVisits, count, penalty ? 1.0f / penalty : 1.0f);
+  alignas(32) float value[lanes];
+  for (uint_fast8_t i = 0; i < lanes; ++i)
+    value[i] = Formula::value(ctx, mean[i], rsqrt[i]) + floor[i];
+  float top = value[0];
+  for (uint_fast8_t i = 1; i < lanes; ++i)
+    top = value[i] > top ? value[i] : top;
+  if (top == -INFINITY) // only proven losses
+    return lost;
+  unsigned at = 0;
+  for (uint_fast8_t i = 0; i < lanes; ++i)
+    at |= unsigned(value[i] == top) << i;
+  return __builtin_ctz(at);
+}
+
+// counts the visit up front and scores it as a full loss until
+// backpropagate() knows the real reward
+uint_fast32_t MCTS::addVirtualLoss(Node* node, uint_fast8_t slot, int_fast32_t penalty)
+{
+  node->total.fetch_add(1, std::memory_order_relaxed);
+  node->scores[slot].fetch_sub(penalty, std::memory_order_relaxed);
+  return node->visits[slot].fetch_add(1, std::memory_order_relaxed);
 }
 
-Node* MCTS::expand(Node* node)
+// for iterations that end without a reward
+void MCTS::revertVirtualLoss(const Step* path, uint_fast8_t depth, int_fast32_t penalty)
 {
-  assert(!node->terminal);
-  assert(!node->expanded);
-  xoroshiro128plus prng;
-  uint_fast8_t move;
-  do
+  for (uint_fast8_t i = depth; i-- > 0;)
   {
-    move = prng.next() % cols;
+    Node* node = &nodes[path[i].node];
+    node->total.fetch_sub(1, std::memory_order_relaxed);
+    node->visits[path[i].slot].fetch_sub(1, std::memory_order_relaxed);
+    node->scores[path[i].slot].fetch_add(penalty, std::memory_order_relaxed);
   }
-  while (node->moves[move]);
-  Node* newNode = new Node();
-  if (node->b.legalMove(move))
+}
+
+// rewards are from the first player's side, each move keeps its score
+// from the side of the player making it, who is the root's player to move
+// on even steps
+void MCTS::backpropagate(const Step* path, uint_fast8_t depth, int_fast32_t reward, int_fast32_t penalty)
+{
+  bool proving = depth && nodes[path[depth-1].node].proofs[path[depth-1].slot] != Proof::unknown;
+  for (uint_fast8_t i = depth; i-- > 0;)
   {
-    newNode->b = node->b;
-    newNode->move = move;
-    newNode->b.dropPiece(move);
+    Node* node = &nodes[path[i].node];
+    bool second = board.turn != bool(i & 1);
+    node->scores[path[i].slot].fetch_add((second ? -reward : reward) + penalty, std::memory_order_relaxed);
+    if (proving && i)
+    {
+      Proof proof = settle(node);
+      if (proof == Proof::unknown)
+        proving = false;
+      else // a position won for the player to move was lost by the move into it
+        nodes[path[i-1].node].proofs[path[i-1].slot].store(flip(proof), std::memory_order_relaxed);
+    }
   }
-  else
+}
+
+Proof MCTS::settle(const Node* node)
+{
+  const uint_fast8_t count = node->count();
+  Proof best = Proof::loss;
+  bool open = false;
+  for (uint_fast8_t i = 0; i < count; ++i)
   {
-    newNode->terminal = true;
-    newNode->UCT = -INFINITY;
+    Proof proof = node->proofs[i].load(std::memory_order_relaxed);
+    if (proof == Proof::win)
+      return proof;
+    if (proof == Proof::unknown)
+      open = true;
+    else if (proof > best)
+      best = proof;
   }
-
-  newNode->root = node;
-  node->moves[move] = true;
-  node->children[node->inserted++] = newNode;
-  if (node->inserted == cols)
-    node->expanded = true;
-
-  return newNode;
+  return open ? Proof::unknown : best;
 }
 
-int_fast16_t MCTS::simulate(Node* node, uint_fast32_t iter, uint_fast8_t simThreads)
+void MCTS::task(std::atomic<int_fast64_t>& budget, uint_fast32_t simIter, uint_fast8_t simThreads, Streams& rng,
+                PhaseStats& stats)
 {
-  if (node->b.isDraw())
-    return -node->score;
-
-  std::atomic<uint_fast64_t> score = 0;
-  Board cc = node->b;
-  xoroshiro128plus prng;
-  auto simTask = [&cc, &score, iter](xoroshiro128plus prng) {
-    int_fast32_t s = 0;
-    for (uint_fast16_t i = 0; i < iter; ++i)
+  stats.enter();
+  Arena<Node>::Cursor cursor; // this thread's slice of the arena
+  Pending pending(batchSize);
+  const int_fast32_t penalty = simIter * simThreads; // every playout lost
+  int_fast64_t left;
+  while (!stopped()
+         && (left = budget.fetch_sub(1, std::memory_order_relaxed)) > 0)
+  {
+    iterations.fetch_add(1, std::memory_order_relaxed);
+    checkLimits(left - 1);
+    stats.mark();
+    Leaf& leaf = pending.leaves[0];
+    leaf.board = board;
+    const bool fresh = select(leaf.board, leaf.path, leaf.depth, penalty, cursor);
+    stats.lap(Phase::select);
+    const Step& last = leaf.path[leaf.depth-1];
+    if (!fresh)
     {
-      Board copy(cc);
-      while (!copy.isDraw() && !copy.isWin())
-      {
-        uint_fast8_t move;
-        do
-        {
-          move = prng.next() % cols;
-        }
-        while (!copy.legalMove(move));
-        copy.dropPiece(move);
-      }
-      s += copy.state;
+      Proof proof = nodes[last.node].proofs[last.slot].load(std::memory_order_relaxed);
+      backpropagate(leaf.path, leaf.depth, reward(leaf.depth, result(proof), penalty), penalty);
+      stats.lap(Phase::backpropagate);
+      continue;
+    }
+    if (solvable(leaf.board)) // exact, nothing to evaluate
+    {
+      int_fast32_t score = reward(leaf.depth, prove(&nodes[last.node], last.slot, leaf.board), penalty);
+      stats.lap(Phase::simulate);
+      backpropagate(leaf.path, leaf.depth, score, penalty);
+      stats.lap(Phase::backpropagate);
+      stats.leaf(leaf.depth, 0);
+      continue;
+    }
+    // on its own, or when the queue is full
+    if (batchSize <= 1 || !leaves.push(leaf))
+    {
+      pending.size = 1;
+      if (!evaluate(pending, simIter, simThreads, rng, stats))
+        break;
+      continue;
     }
-    score += s;
-  };
+    if (leaves.size() < batchSize)
+      continue;
+    while (pending.size < batchSize && leaves.pop(pending.leaves[pending.size]))
+      pending.size++;
+    if (pending.size && !evaluate(pending, simIter, simThreads, rng, stats))
+      break;
+  }
+  // every worker empties the queue on its way out, so none of its own
+  // leaves are left behind; once stopped they are only reverted
+  for (;;)
+  {
+    while (pending.size < pending.leaves.size() && leaves.pop(pending.leaves[pending.size]))
+      pending.size++;
+    if (!pending.size)
+      break;
+    evaluate(pending, simIter, simThreads, rng, stats);
+  }
+  stats.leave();
+}
 
-  std::thread simWorkers[simThreads];
-  for (uint_fast8_t i = 0; i < simThreads; ++i)
+// a root nothing has searched yet may still face the way it was given,
+// and mirror or prune may have changed since
+uint_fast8_t MCTS::prepareRoot()
+{
+  Node* node = &nodes[root];
+  if (!node->total)
   {
-    xoroshiro128plus prng;
-    simWorkers[i] = std::thread(simTask, prng);
+    flipped ^= fold(board);
+    node->legal = candidates(board);
   }
-  for (uint_fast8_t i = 0; i < simThreads; ++i)
+  return moveCount(board.legalMoves());
+}
+
+unsigned MCTS::workerCount()
+{
+  unsigned cores = std::thread::hardware_concurrency();
+  return threads < 1 ? 1 : cores && threads > cores ? cores : threads;
+}
+
+uint_fast8_t MCTS::run(uint_fast32_t loopIter, uint_fast32_t simIter, uint_fast8_t simThreads)
+{
+  stopPondering();
+  deadline = std::chrono::steady_clock::time_point::max();
+  nodeLimit = 0;
+  return search(int_fast64_t(loopIter) * prepareRoot(), simIter, simThreads);
+}
+
+uint_fast8_t MCTS::runFor(std::chrono::milliseconds time, uint_fast32_t simIter, uint_fast8_t simThreads)
+{
+  return runUntil(std::chrono::steady_clock::now() + time, simIter, simThreads);
+}
+
+uint_fast8_t MCTS::runUntil(std::chrono::steady_clock::time_point until, uint_fast32_t simIter, uint_fast8_t simThreads)
+{
+  stopPondering();
+  deadline = until;
+  nodeLimit = 0;
+  return search(INT_FAST64_MAX, simIter, simThreads);
+}
+
+uint_fast8_t MCTS::runNodes(uint_fast64_t nodeBudget, uint_fast32_t simIter, uint_fast8_t simThreads)
+{
+  stopPondering();
+  deadline = std::chrono::steady_clock::time_point::max();
+  nodeLimit = nodeBudget;
+  return search(int_fast64_t(nodeBudget) * iterationsPerNode, simIter, simThreads);
+}
+
+uint_fast8_t MCTS::search(int_fast64_t budget, uint_fast32_t simIter, uint_fast8_t simThreads)
+{
+  start = std::chrono::steady_clock::now();
+  iterations = 0;
+  made = 0;
+  stop = false;
+  uint_fast8_t move = think(budget, simIter, simThreads);
+  return flipped && move < cols ? cols - 1 - move : move;
+}
+
+uint_fast8_t MCTS::think(int_fast64_t budget, uint_fast32_t simIter, uint_fast8_t simThreads)
+{
+  stats = SearchStats();
+  // nothing to think about, one legal move or one left by prune
+  if (prepareRoot() <= 1 || nodes[root].count() <= 1)
+    return bestMove(root);
+
+  xoroshiro128plus streams(seed);
+  seed = streams.next(); // the next search draws new numbers
+
+  auto began = std::chrono::steady_clock::now();
+  uint_fast64_t usedBefore = nodes.used();
+  unsigned n = workerCount();
+  std::vector<PhaseStats> phases(n);
+  if (batchSize > 1) // with room to spare, a full queue costs batching
+    leaves.resize(2 * n * batchSize);
+  if (mode == Parallelism::ensemble && n > 1)
   {
-    if (simWorkers[i].joinable())
-      simWorkers[i].join();
+    uint_fast8_t move = runEnsemble(budget, simIter, simThreads, n, streams, phases.data());
+    phases[0].nodes = nodes.used() - usedBefore;
+    collect(phases, began);
+    return move;
   }
+  ensemble.clear();
+  if (deterministic) // workers racing down one tree never replay
+    n = 1;
+  phases.resize(n);
+
+  std::vector<Streams> rng;
+  rng.reserve(n);
+  for (unsigned i = 0; i < n; ++i)
+    rng.emplace_back(streams, i, simThreads * batchSize);
+  std::atomic<int_fast64_t> shared = budget;
+  std::atomic<uint_fast32_t> pending = n - 1;
+  for (unsigned i = 1; i < n; ++i)
+    pool->submit([&, i]()
+    {
+      task(shared, simIter, simThreads, rng[i], phases[i]);
+    }, pending);
+  task(shared, simIter, simThreads, rng[0], phases[0]); // the caller is worker 0
+  pool->wait(pending);
+
+  phases[0].nodes = nodes.used() - usedBefore;
+  collect(phases, began);
+  return bestMove(root);
+}
 
-  return score;
+void MCTS::collect(const std::vector<PhaseStats>& phases, std::chrono::steady_clock::time_point began)
+{
+  if constexpr (!statsEnabled)
+    return;
+  stats.workers = phases.size();
+  stats.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+  stats.idle = stats.wall * stats.workers;
+  stats.bytesPerNode = sizeof(Node);
+  for (const PhaseStats& worker : phases)
+    stats.add(worker);
 }
 
-float MCTS::calcUCT(Node* node)
+void MCTS::ponder(uint_fast32_t simIter, uint_fast8_t simThreads)
 {
-  return 1.0 * node->score / node->visits + EXPL
-     * sqrt(2 * log(node->root->visits) / node->visits);
+  stopPondering();
+  Board b = board;
+  if (b.isWin() || b.isDraw())
+    return;
+
+  // no clock and no early stop, it runs until the opponent moves or it
+  // has made ponderNodes nodes
+  deadline = std::chrono::steady_clock::time_point::max();
+  nodeLimit = ponderNodes;
+  ponderEarlyStop = earlyStop;
+  earlyStop = false;
+  start = std::chrono::steady_clock::now();
+  iterations = 0;
+  made = 0;
+  stop = false;
+  pondering = 1;
+  pondered = true;
+  pool->submit([this, simIter, simThreads]()
+  {
+    think(int_fast64_t(ponderNodes) * iterationsPerNode, simIter, simThreads);
+  }, pondering);
 }
 
-void MCTS::backpropagate(Node* node, float reward, uint_fast8_t who)
+void MCTS::stopPondering()
 {
-  while (node) // != nullptr
+  if (!pondered) // a ponder that hit its cap still needs earlyStop back
+    return;
+  stop = true;
+  pool->wait(pondering); // runs the search itself if it never got a thread
+  earlyStop = ponderEarlyStop;
+  pondered = false;
+}
+
+void MCTS::checkLimits(int_fast64_t remaining)
+{
+  auto now = std::chrono::steady_clock::now();
+  const uint_fast64_t madeSoFar = made.load(std::memory_order_relaxed);
+  if (now >= deadline || (nodeLimit && madeSoFar >= nodeLimit))
+  {
+    stop = true;
+    return;
+  }
+  if (settle(&nodes[root]) != Proof::unknown) // more iterations can't change the move
+  {
+    stop = true;
+    return;
+  }
+  if (!earlyStop)
+    return;
+
+  // on a clock, the iterations still to come follow the pace so far
+  if (deadline != std::chrono::steady_clock::time_point::max())
+  {
+    double elapsed = std::chrono::duration<double>(now - start).count();
+    double left = std::chrono::duration<double>(deadline - now).count();
+    double pace = iterations / (elapsed > 1e-6 ? elapsed : 1e-6);
+    if (pace * left < remaining)
+      remaining = pace * left;
+  }
+  // on a node budget, at the iterations per node so far
+  if (nodeLimit && madeSoFar)
   {
-    node->visits++;
-    if (node->root) // error here, won't fully backpropagate up to "root", stops at the temp root, which also needs to be updated
+    double left = double(iterations) / madeSoFar * (nodeLimit - madeSoFar);
+    if (left < remaining)
+      remaining = left;
+  }
+  if (decided(remaining))
+    stop = true;
+}
+
+bool MCTS::decided(int_fast64_t remaining)
+{
+  const Node* node = &nodes[root];
+  uint_fast32_t first = 0, second = 0;
+  for (uint_fast8_t i = 0; i < node->count(); ++i)
+  {
+    uint_fast32_t v = node->visits[i].load(std::memory_order_relaxed);
+    if (v > first)
     {
-      node->score += reward;
-      node->UCT = calcUCT(node);
-      reward *= -1;
+      second = first;
+      first = v;
     }
-    node = node->root;
+    else if (v > second)
+      second = v;
   }
+  return int_fast64_t(first - second) > remaining;
 }
 
-void MCTS::task(uint_fast32_t loopIter, uint_fast32_t simIter, uint_fast8_t simThreads, uint_fast8_t who)
+// each tree gets an equal share of the iterations and runs them in rounds
+// of mergeEvery on its own thread; nothing is shared until the merge
+uint_fast8_t MCTS::runEnsemble(int_fast64_t budget, uint_fast32_t simIter, uint_fast8_t simThreads, unsigned n,
+                               const xoroshiro128plus& streams, PhaseStats* phases)
 {
-  for (uint_fast32_t i = 0; i < loopIter; ++i)
+  if (ensemble.size() != n - 1)
   {
-    Node* spare; // temp solution
-    Node* selected = select(root->children[who], spare);
-    if (!selected)
+    ensemble.clear();
+    for (unsigned i = 1; i < n; ++i)
     {
-      assert(spare != nullptr);
-      backpropagate(spare, spare->b.state * simIter, who);
-      continue;
+      ensemble.emplace_back(new MCTS(board));
+      ensemble.back()->EXPL = EXPL;
+      ensemble.back()->exploration = exploration;
+      ensemble.back()->useTT = useTT;
+      ensemble.back()->solveBelow = solveBelow;
+      ensemble.back()->mirror = mirror;
+      ensemble.back()->prune = prune;
+      ensemble.back()->policy = policy;
+      ensemble.back()->evaluator = evaluator;
+      ensemble.back()->batchSize = batchSize;
+      ensemble.back()->owner = this;
+      ensemble.back()->flipped = flipped; // our board faces their way already
     }
-    Node* expanded = expand(selected);
-    float score = simulate(expanded, simIter, simThreads);
-    backpropagate(expanded, score, who);
   }
+  for (std::unique_ptr<MCTS>& tree : ensemble)
+  {
+    // our tree watches the clock and node limit, theirs only the deadline
+    tree->seed = seed;
+    tree->prepareRoot();
+    tree->stop = false;
+    tree->made = 0;
+    tree->earlyStop = false;
+    tree->deadline = deadline;
+    tree->nodeLimit = 0;
+    if (batchSize > 1)
+      tree->leaves.resize(2 * batchSize);
+  }
+
+  std::vector<uint_fast64_t> usedBefore;
+  for (std::unique_ptr<MCTS>& tree : ensemble)
+    usedBefore.push_back(tree->nodes.used());
+
+  // streams live for the whole search so rounds don't repeat them
+  std::vector<Streams> rng;
+  rng.reserve(n);
+  for (unsigned i = 0; i < n; ++i)
+    rng.emplace_back(streams, i, simThreads * batchSize);
+
+  // a round's budget says nothing about the whole search, so early
+  // stopping waits for the merged statistics
+  bool early = earlyStop;
+  earlyStop = false;
+  int_fast64_t perTree = budget / n + (budget % n != 0);
+  while (perTree > 0 && !stop)
+  {
+    int_fast64_t round = perTree < int_fast64_t(mergeEvery) ? perTree : int_fast64_t(mergeEvery);
+    perTree -= round;
+    std::atomic<uint_fast32_t> pending = n - 1;
+    for (unsigned i = 1; i < n; ++i)
+      pool->submit([&, i]()
+      {
+        std::atomic<int_fast64_t> theirs = round;
+        ensemble[i-1]->task(theirs, simIter, simThreads, rng[i], phases[i]);
+      }, pending);
+    std::atomic<int_fast64_t> mine = round;
+    task(mine, simIter, simThreads, rng[0], phases[0]);
+    pool->wait(pending);
+    mergeRoots();
+    if (early && decided(perTree))
+      break;
+  }
+  earlyStop = early;
+  for (unsigned i = 1; i < n; ++i)
+    phases[i].nodes = ensemble[i-1]->nodes.used() - usedBefore[i-1];
+
+  return bestMove(root);
 }
 
-uint_fast8_t MCTS::run(uint_fast32_t loopIter, uint_fast32_t simIter, uint_fast8_t simThreads)
+// a move any tree visited keeps at least one visit, and its score is
+// scaled with the visits so its mean survives the rounding
+void MCTS::mergeRoots()
 {
-  // expand base 7 children
-  for (uint_fast8_t i = 0; i < cols; ++i)
-    expand(root);
+  const uint_fast64_t n = ensemble.size() + 1;
+  Node* mine = &nodes[root];
+  for (std::unique_ptr<MCTS>& tree : ensemble)
+    playouts += tree->playouts.exchange(0);
 
-  for (uint_fast8_t i = 0; i < cols; ++i)
+  // every tree has the same root, slots and all
+  uint_fast64_t rootVisits = 0;
+  for (uint_fast8_t i = 0; i < mine->count(); ++i)
   {
-    if (!root->children[i]->terminal)
+    int_fast64_t score = mine->scores[i];
+    uint_fast64_t visits = mine->visits[i];
+    Proof proof = mine->proofs[i];
+    for (std::unique_ptr<MCTS>& tree : ensemble)
     {
-      root->children[i]->root = new Node();
-      workers[i] = std::thread([&, loopIter, simIter, i]()
-                   {task(loopIter, simIter, simThreads, i);});
+      Node* theirs = &tree->nodes[tree->root];
+      score += theirs->scores[i];
+      visits += theirs->visits[i];
+      if (theirs->proofs[i] != Proof::unknown) // one tree's proof holds for all
+        proof = theirs->proofs[i];
     }
+    const uint_fast64_t merged = visits && visits < n ? 1 : visits / n;
+    const int_fast64_t scaled = visits ? score * int_fast64_t(merged) / int_fast64_t(visits) : 0;
+    rootVisits += merged;
+
+    auto write = [&](Node* node)
+    {
+      node->scores[i] = scaled;
+      node->visits[i] = merged;
+      node->proofs[i] = proof;
+    };
+    write(mine);
+    for (std::unique_ptr<MCTS>& tree : ensemble)
+      write(&tree->nodes[tree->root]);
   }
-  for (uint_fast8_t i = 0; i < cols; ++i)
-    if (workers[i].joinable())
+  // the sum of the merged moves, as addVirtualLoss() keeps it
+  mine->total = rootVisits;
+  for (std::unique_ptr<MCTS>& tree : ensemble)
+    tree->nodes[tree->root].total = rootVisits;
+}
+
+// the most visited legal move, which early stopping can tell is settled;
+// a solved win is played and a solved loss avoided whatever the visits
+uint_fast8_t MCTS::bestMove(uint32_t idx)
+{
+  const Node* node = &nodes[idx];
+  uint_fast32_t visits = 0;
+  int_fast8_t rank = 0;
+  uint_fast8_t best = cols;
+  for (uint_fast8_t i = 0; i < node->count(); ++i)
+  {
+    Proof proof = node->proofs[i];
+    int_fast8_t r = proof == Proof::win ? 1 : proof == Proof::loss ? -1 : 0;
+    uint_fast32_t v = node->visits[i];
+    if (best == cols || r > rank || (r == rank && v > visits))
     {
-      workers[i].join();
-      delete root->children[i]->root;
-      root->children[i]->root = root;
+      rank = r;
+      visits = v;
+      best = i;
     }
-
-  return bestMove(root);
+  }
+  return best == cols ? cols : node->move(best);
 }
 
-uint_fast8_t MCTS::bestMove(Node* node)
+void MCTS::advance(uint_fast8_t move)
 {
-  float UCT = -INFINITY;
-  uint_fast8_t move;
-  for (uint_fast8_t i = 0; i < cols; ++i)
+  stopPondering();
+  for (std::unique_ptr<MCTS>& tree : ensemble)
+    tree->advance(move);
+
+  if (flipped)
+    move = cols - 1 - move;
+  if (board.key == board.mirrorKey && !(distinct(board) >> move & 1))
   {
-    if (node->children[i] && !node->children[i]->terminal)
+    // a position that is its own mirror only searched the left half
+    move = cols - 1 - move;
+    flipped = !flipped;
+  }
+  const Node* node = &nodes[root];
+  uint32_t next = node->legal >> move & 1 ? node->children[node->slot(move)].load() : 0;
+  board.dropPiece(move);
+  flipped ^= fold(board);
+
+  // copy what we keep, then drop the old tree in O(1) with a reset
+  Arena<Node>::Cursor cursor;
+  spare.reset();
+  if (useTT)
+    tt.clear(); // refilled with the copies
+  if (next)
+    root = copyTree(next, board, cursor);
+  else // never searched, start over from the position
+    root = spare.alloc(cursor, candidates(board));
+  nodes.swap(spare);
+  spare.reset();
+}
+
+// shared children are copied once, so the copy stays a DAG
+uint32_t MCTS::copyTree(uint32_t idx, const Board& b, Arena<Node>::Cursor& cursor)
+{
+  uint32_t copy = useTT && b.key ? tt.lookup(b.key) : 0;
+  if (copy)
+    return copy;
+  copy = spare.alloc(cursor, nodes[idx]);
+  if (useTT && b.key)
+    tt.insert(b.key, copy);
+  for (uint_fast8_t i = 0; i < nodes[idx].count(); ++i)
+    if (uint32_t child = nodes[idx].children[i])
     {
-      if (node->children[i]->UCT > UCT)
-      {
-        UCT = node->children[i]->UCT;
-        move = node->children[i]->move;
-      }
+      Board next = b;
+      next.dropPiece(nodes[idx].move(i));
+      fold(next);
+      spare[copy].children[i] = copyTree(child, next, cursor);
     }
-  }
-  return move;
+  return copy;
 }
@@ -1,30 +1,124 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <thread>
+#include <vector>
+#include "arena.h"
 #include "board.h"
+#include "evaluator.h"
+#include "queue.h"
+#include "rollout.h"
+#include "solver.h"
+#include "stats.h"
+#include "threadpool.h"
+#include "tt.h"
+#include "uct.h"
 #include "xoroshiro128plus.h"
 
-struct Node
+// what the solver proved about a move, for the player making it
+enum class Proof : uint8_t
 {
-  Node();
-  Node(const Board& board);
-  Node(const Node* other);
-  ~Node();
+  unknown,
+  loss,
+  draw,
+  win
+};
+
+// -1, 0 or 1 for a known proof
+constexpr int_fast8_t result(Proof proof)
+{
+  return int_fast8_t(proof) - 2;
+}
+
+// the same outcome seen by the other player
+constexpr Proof flip(Proof proof)
+{
+  return proof == Proof::win ? Proof::loss : proof == Proof::loss ? Proof::win : proof;
+}
+
+// Only positions the search has descended through get a node, and they
+// don't keep their board: select() replays the moves from the root. Every
+// move of a node is there from the start, one slot each counting out from
+// the centre, and its statistics live in the node it is made from, each
+// kind in its own array, so scoring every move of a node reads two cache
+// lines and nothing in them belongs to a full column
+struct alignas(64) Node
+{
+  Node(uint_fast8_t legal = 0);
+  Node(const Node& other);
 
-  Board b;
-  Node* root;
-  Node* children[cols]; // syncs up with moves[cols]
+  // arena indices by slot, 0 until the search descends through the move;
+  // with the transposition table a child may be shared by several
+  // parents, so nodes don't know their parent
+  std::atomic<uint32_t> children[cols] = {};
+  // every worker reads and bumps these without locks
+  std::atomic<uint32_t> visits[cols] = {};
+  std::atomic<int64_t> scores[cols] = {}; // from the side of the player making the move
+  std::atomic<uint32_t> total = 0; // visits of the position, summed over its moves
+  std::atomic<Proof> proofs[cols] = {};
 
-  bool terminal;
-  bool expanded;
-  bool moves[cols]; // true for which moves have we used?
+  uint8_t legal; // the columns searched from here, one per slot
 
-  float UCT;
-  uint_fast8_t move = 69;
-  uint_fast8_t inserted;
-  int_fast32_t score;
-  uint_fast32_t visits;
+  uint_fast8_t count() const
+  {
+    return moveCount(legal);
+  }
+  // the column of a slot and the slot of a column in legal
+  uint_fast8_t move(uint_fast8_t slot) const
+  {
+    return nthFromCentre(legal, slot);
+  }
+  uint_fast8_t slot(uint_fast8_t move) const
+  {
+    return centreRank(legal, move);
+  }
+};
+
+// one edge of a descent, the node it leaves and the slot of its move
+struct Step
+{
+  uint32_t node;
+  uint_fast8_t slot;
+};
+
+// a move no iteration made before, waiting for the evaluator with a
+// virtual loss on every step of the path to it
+struct Leaf
+{
+  Board board; // the position it reaches
+  Step path[size];
+  uint_fast8_t depth;
+};
+
+// the leaves one worker evaluates together, room for MCTS::batchSize
+struct Pending
+{
+  Pending(uint_fast32_t batchSize);
+
+  std::vector<Leaf> leaves;
+  std::vector<Board> boards; // what the evaluator sees of leaves
+  std::vector<int_fast32_t> values;
+  uint_fast32_t size = 0;
+};
+
+// the random numbers of one worker, cut from the search's stream: the
+// worker's own long_jump() and then one jump() per rollout lane, so no two
+// overlap and the same seed hands out the same numbers
+struct Streams
+{
+  Streams(const xoroshiro128plus& search, unsigned worker, uint_fast32_t batches);
+
+  std::vector<xoroshiro128plus> rollouts; // maxLanes per rollout batch
+};
+
+// how run() puts its workers to use
+enum class Parallelism : uint_fast8_t
+{
+  sharedTree, // all workers descend one tree, spread out by virtual loss
+  ensemble    // one private tree per worker, root statistics merged
 };
 
 struct MCTS
@@ -33,22 +127,169 @@ struct MCTS
   // copy constructor never used
   ~MCTS();
 
-  Node* root;
+  Arena<Node> nodes;
+  Arena<Node> spare; // the kept subtree is compacted into it by advance()
+  TranspositionTable tt;
+  bool useTT = true; // share one node between transpositions
+  Solver solver;
+  // positions with fewer empty cells are solved instead of played out and
+  // their moves never searched again, 0 turns it off
+  uint_fast8_t solveBelow = 16;
+  // the root position, or its mirror image when flipped: the tree keeps
+  // every position the way round whose key is smaller, so both images
+  // share one node, and moves in and out are turned to match
+  Board board;
+  bool flipped = false;
+  // search mirror images as one position, and only the left half and
+  // centre of a position that is its own mirror; set before searching
+  bool mirror = true;
+  // search only a winning move when there is one, else only the blocks of
+  // the opponent's win, and never a move right under one; every move cut
+  // loses at once, so proofs still hold
+  bool prune = true;
+  uint32_t root;
   float EXPL = 0.58578643762690485; // 2-sqrt2, WAY better than sqrt(2)
+  Exploration exploration = Exploration::ucb1; // the formula EXPL goes into
   //int createdNodes = 0;
-  std::thread workers[cols];
-  //uint_fast8_t (*prngs[cols])(); // each thread has its own prng
-  // or create/destroy instance of function every time running simluation?
-
-  Node* select(Node* node, Node*& spare);
-  Node* expand(Node* node);
-  int_fast16_t simulate(Node* node, uint_fast32_t iter, uint_fast8_t simThreads = 1);
-  inline float calcUCT(Node* node);
-  void backpropagate(Node* node, float reward, uint_fast8_t who);
-  void task(uint_fast32_t loopIter, uint_fast32_t simIter, uint_fast8_t simThreads, uint_fast8_t who);
+  // workers descending the one shared tree, clamped to the core count
+  unsigned threads = std::thread::hardware_concurrency();
+  Parallelism mode = Parallelism::sharedTree;
+  uint_fast32_t mergeEvery = 256; // ensemble iterations per tree between merges
+  // the other trees of the ensemble, kept in step with ours by advance()
+  std::vector<std::unique_ptr<MCTS>> ensemble;
+  ThreadPool* pool = &ThreadPool::shared(); // runs the workers and rollout batches
+  std::atomic<uint_fast64_t> playouts = 0;
+  // where the last search spent its time, zero unless built with
+  // CONNECT4_STATS; json() gives it as one line for a per-move log
+  SearchStats stats;
+  // values the leaves, &rollouts() plays them out with the two settings
+  // below; not owned, one evaluator can serve any number of searches
+  Evaluator* evaluator = &rollouts();
+  bool batchedRollouts = true; // vector lanes when the CPU has them
+  Policy policy = Policy::heavy; // how rollouts pick their moves
+  // leaves evaluated together, at least 1; above 1 the workers queue
+  // their leaves and whoever finds batchSize waiting takes them, so the
+  // others keep descending while a batch is evaluated
+  uint_fast32_t batchSize = 1;
+  BoundedQueue<Leaf> leaves; // sized for the workers by think()
+  // each search takes its streams from seed and moves it on, so a game
+  // started from one seed replays; random unless set
+  uint64_t seed;
+  // one worker on the shared tree so the same seed and thread count give
+  // the same search; holds for run() and runNodes(), not for the clock
+  bool deterministic = false;
+
+  // limits of the search in progress, checked by every worker after each
+  // iteration and every 64 playouts inside rollout batches
+  std::atomic<bool> stop = false; // set from anywhere to end the search
+  // the search this one is an ensemble tree of, whose stop ends it too
+  const MCTS* owner = nullptr;
+  bool earlyStop = true; // stop once the most visited root move is settled
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point deadline;
+  uint_fast64_t nodeLimit = 0; // nodes made, 0 is none
+  std::atomic<uint_fast64_t> iterations = 0; // done in this search
+  std::atomic<uint_fast64_t> made = 0; // nodes attach() allocated in this search
+  // iterations runNodes() allows per node of its budget: once the search
+  // settles on proven moves and transpositions it makes no more nodes
+  static constexpr uint_fast32_t iterationsPerNode = 16;
+
+  // a background search of the current root while the opponent thinks
+  std::atomic<uint_fast32_t> pondering = 0;
+  bool ponderEarlyStop; // earlyStop to restore once pondering ends
+  bool pondered = false; // started, and not stopped yet
+  // nodes a ponder makes at most, 256 MB of them, with iterationsPerNode
+  // iterations each; an opponent who never moves would fill memory
+  uint_fast64_t ponderNodes = UINT64_C(1) << 21;
+
+  // descends from the root until it makes a move no iteration has made
+  // before, or one that leads to a position the search proves rather than
+  // plays out, and returns true; false when the last move is proven and its
+  // result takes a rollout's place. b is played along from the root
+  // position, path gets every move made and each gets a virtual loss of
+  // penalty so other workers spread out
+  bool select(Board& b, Step* path, uint_fast8_t& depth, int_fast32_t penalty, Arena<Node>::Cursor& cursor);
+  // select() with the formula fixed
+  template <class Formula>
+  bool descend(Board& b, Step* path, uint_fast8_t& depth, int_fast32_t penalty, Arena<Node>::Cursor& cursor);
+  // turns b to face the way the tree keeps it, true when that flipped it
+  bool fold(Board& b);
+  // the legal moves of b that lead to different positions
+  uint_fast8_t distinct(const Board& b);
+  // the distinct moves of b the search tries, cut down by prune
+  uint_fast8_t candidates(const Board& b);
+  // a win or a full board, or few enough empty cells for the solver
+  bool solvable(Board& b);
+  // the node of the position the move in slot leads to from parent, made
+  // with all its moves on first use
+  uint32_t attach(Node* parent, uint_fast8_t slot, const Board& b, Arena<Node>::Cursor& cursor);
+  // proves the position b that the move in slot reaches from node, a win
+  // or a full board as it stands and anything else with the solver, and
+  // records the result, -1, 0 or 1 for the player making the move
+  int_fast8_t prove(Node* node, uint_fast8_t slot, Board& b);
+  // result for the player making the last move of a path depth long, as
+  // a reward from the first player's side
+  int_fast32_t reward(uint_fast8_t depth, int_fast8_t result, int_fast32_t penalty);
+  // has the evaluator value every pending leaf and backpropagates them,
+  // or reverts them all and returns false when the search stopped
+  bool evaluate(Pending& pending, uint_fast32_t simIter, uint_fast8_t simThreads, Streams& rng, PhaseStats& stats);
+  // the slot the formula scores best, the first without visits before
+  // any; a proven win is taken at once and proven losses only when all
+  // are. penalty is the playouts of one visit
+  template <class Formula>
+  uint_fast8_t bestChild(const Node* node, uint_fast32_t parentVisits, int_fast32_t penalty);
+  // returns the visits of the slot before this one
+  uint_fast32_t addVirtualLoss(Node* node, uint_fast8_t slot, int_fast32_t penalty);
+  void revertVirtualLoss(const Step* path, uint_fast8_t depth, int_fast32_t penalty);
+  // the visits were counted by select, this swaps the virtual loss for
+  // reward; when the last move is proven the proof climbs the path for as
+  // long as it settles the nodes it reaches
+  void backpropagate(const Step* path, uint_fast8_t depth, int_fast32_t reward, int_fast32_t penalty);
+  // the value of a node for the player to move once its proven moves
+  // decide it, by one winning move or by every move being proven
+  Proof settle(const Node* node);
+  void task(std::atomic<int_fast64_t>& budget, uint_fast32_t simIter, uint_fast8_t simThreads, Streams& rng,
+            PhaseStats& stats);
+  // loopIter iterations per legal root move, shared out among the workers
   uint_fast8_t run(uint_fast32_t loopIter, uint_fast32_t simIter, uint_fast8_t simThreads);
-  uint_fast8_t bestMove(Node* node);
+  // anytime variants, they return the best move found when time runs out
+  uint_fast8_t runFor(std::chrono::milliseconds time, uint_fast32_t simIter, uint_fast8_t simThreads);
+  uint_fast8_t runUntil(std::chrono::steady_clock::time_point until, uint_fast32_t simIter, uint_fast8_t simThreads);
+  // at most nodeBudget new nodes, and iterationsPerNode iterations each
+  uint_fast8_t runNodes(uint_fast64_t nodeBudget, uint_fast32_t simIter, uint_fast8_t simThreads);
+  uint_fast8_t search(int_fast64_t budget, uint_fast32_t simIter, uint_fast8_t simThreads);
+  // the search itself, without resetting the limits
+  uint_fast8_t think(int_fast64_t budget, uint_fast32_t simIter, uint_fast8_t simThreads);
+  // keeps searching the current root on the pool and returns at once;
+  // the next run or advance stops it and keeps what it found
+  void ponder(uint_fast32_t simIter, uint_fast8_t simThreads);
+  void stopPondering();
+  uint_fast8_t runEnsemble(int_fast64_t budget, uint_fast32_t simIter, uint_fast8_t simThreads, unsigned n,
+                           const xoroshiro128plus& streams, PhaseStats* phases);
+  // merges the workers' counts into stats once the search is over
+  void collect(const std::vector<PhaseStats>& phases, std::chrono::steady_clock::time_point began);
+  // stop, or the owner's
+  bool stopped() const
+  {
+    return stop.load(std::memory_order_relaxed) || (owner && owner->stop.load(std::memory_order_relaxed));
+  }
+  // sets stop when a limit is hit or the root is proven, remaining is
+  // what's left of the budget
+  void checkLimits(int_fast64_t remaining);
+  // true when no root move can catch up with the most visited one
+  bool decided(int_fast64_t remaining);
+  // averages the root moves over the ensemble and writes them back, with
+  // any tree's proofs
+  void mergeRoots();
+  // how many moves are legal from the root, after a fresh root is folded
+  uint_fast8_t prepareRoot();
+  unsigned workerCount();
+  uint_fast8_t bestMove(uint32_t node);
 
-  // other functions, simulate only next 7 possible moves
-  uint_fast8_t goofygoober(Node* node);
+  // re-roots the tree on the child reached by move, keeping its statistics
+  // call once per ply, for our move and for the opponent's reply; after
+  // pondering this promotes the subtree of the move that was played
+  void advance(uint_fast8_t move);
+  // b is the position of node
+  uint32_t copyTree(uint32_t node, const Board& b, Arena<Node>::Cursor& cursor);
 };
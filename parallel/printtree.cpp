@@ -2,25 +2,22 @@
 #include "mcts.h"
 #include "printtree.h"
 
-void printT(const std::string& prefix, const Node* node, bool isLeft)
+void printT(const std::string& prefix, const Arena<Node>& nodes, uint32_t node)
 {
-  if( node != nullptr )
+  if( node != 0 )
   {
-    std::cout << prefix;
-    std::cout << (isLeft ? "├──" : "└──" );
-
-    std::cout << (int) node->move << ' ' << (float) node->UCT << std::endl;
-
-    for (int i = 0; i < cols; ++i)
+    const Node& n = nodes[node];
+    for (int i = 0; i < n.count(); ++i)
     {
-      if (node->children[i])
-      {
-        printT( prefix + (isLeft ? "│   " : "    "), node->children[i], true);
-      }
+      bool last = i + 1 == n.count();
+      uint32_t visits = n.visits[i];
+      std::cout << prefix << (last ? "└──" : "├──");
+      std::cout << int(n.move(i)) << ' ' << visits << ' ' << (visits ? (float) n.scores[i] / visits : 0.0f) << std::endl;
+      printT( prefix + (last ? "    " : "│   "), nodes, n.children[i]);
     }
   }
 }
-void printT(const Node* node)
+void printT(const Arena<Node>& nodes, uint32_t node)
 {
-    printT("", node, false);
+    printT("", nodes, node);
 }
@@ -3,5 +3,7 @@
 #include <string>
 #include "mcts.h"
 
-void printT(const std::string& prefix, const Node* node, bool isLeft);
-void printT(const Node* node);
+// one line per move of node, centre first, its column, visits and mean score,
+// with the moves of its position under it
+void printT(const std::string& prefix, const Arena<Node>& nodes, uint32_t node);
+void printT(const Arena<Node>& nodes, uint32_t node);
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free queue any number of threads push to and pop from.
+// Every cell carries a sequence number that says whose turn it is, so a
+// push or pop is one compare-exchange on its end of the ring and never
+// waits for another thread. A pop may miss an item whose push has claimed
+// its cell but not yet filled it; the pusher finds it again later.
+template <typename T>
+struct BoundedQueue
+{
+  BoundedQueue(uint_fast32_t capacity = 0)
+  {
+    resize(capacity);
+  }
+  BoundedQueue(const BoundedQueue& other) = delete;
+
+  struct Cell
+  {
+    std::atomic<uint64_t> seq;
+    T item;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  uint64_t mask = 0; // cells - 1
+  alignas(64) std::atomic<uint64_t> head = 0; // next pop
+  alignas(64) std::atomic<uint64_t> tail = 0; // next push
+
+  // room for at least capacity items, rounded up to a power of two;
+  // empties the queue, so only while nobody is using it
+  void resize(uint_fast32_t capacity)
+  {
+    uint64_t n = 1;
+    while (n < capacity)
+      n <<= 1;
+    if (!cells || n != mask + 1)
+    {
+      cells.reset(new Cell[n]);
+      mask = n - 1;
+    }
+    for (uint64_t i = 0; i < n; ++i)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+  }
+
+  // false when the queue is full
+  bool push(const T& item)
+  {
+    uint64_t pos = tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      Cell& cell = cells[pos & mask];
+      int64_t turn = int64_t(cell.seq.load(std::memory_order_acquire) - pos);
+      if (turn == 0)
+      {
+        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          cell.item = item;
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (turn < 0) // a lap behind, the last pop hasn't left it
+        return false;
+      else
+        pos = tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  // false when there is nothing to take
+  bool pop(T& item)
+  {
+    uint64_t pos = head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      Cell& cell = cells[pos & mask];
+      int64_t turn = int64_t(cell.seq.load(std::memory_order_acquire) - (pos + 1));
+      if (turn == 0)
+      {
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          item = cell.item;
+          cell.seq.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (turn < 0) // not filled yet
+        return false;
+      else
+        pos = head.load(std::memory_order_relaxed);
+    }
+  }
+
+  // items pushed and not yet popped, a moment ago
+  uint_fast32_t size() const
+  {
+    uint64_t out = head.load(std::memory_order_relaxed);
+    uint64_t in = tail.load(std::memory_order_relaxed);
+    return in > out ? in - out : 0;
+  }
+};
@@ -0,0 +1,187 @@
+#include <cstdint>
+
+#include "board.h"
+#include "rollout.h"
+#include "xoroshiro128plus.h"
+
+namespace
+{
+// the cells of land, where the stones of each open column would land,
+// that the heavy policy picks among: a win for the player to move, else a
+// block of the opponent's win, else those not right under one of their
+// winning cells, and all of land when every move hands them a win
+inline uint64_t heavyCells(uint64_t current, uint64_t mask, uint64_t land)
+{
+  const LandingCells cells = classifyLanding(current, mask, land);
+  return cells.wins ? cells.wins : cells.forced ? cells.forced : cells.safe ? cells.safe : land;
+}
+
+// L games side by side, structure of arrays so every step is a loop over
+// lanes the compiler turns into vector code. A lane that finishes a game
+// banks the result and restarts from b until its share of games is done.
+// Each lane draws from its own stream in lanes, advanced in place.
+template <uint_fast8_t L, Policy policy>
+__attribute__((always_inline)) inline int_fast64_t lockstep(const Board& b, uint_fast32_t games, xoroshiro128plus* lanes)
+{
+  uint64_t s0[L], s1[L], cur[L], mask[L], moves[L], left[L];
+  int64_t acc[L];
+  // the state of a game that ends on an odd number of stones
+  const int64_t odd = b.ogTurn ? -1 : 1;
+  for (uint_fast8_t l = 0; l < L; ++l)
+  {
+    s0[l] = lanes[l].s[0];
+    s1[l] = lanes[l].s[1];
+    cur[l] = b.current;
+    mask[l] = b.mask;
+    moves[l] = b.totalMoves;
+    left[l] = games / L + (l < games % L);
+    acc[l] = 0;
+  }
+
+  for (;;)
+  {
+    uint64_t busy = 0;
+    for (uint_fast8_t l = 0; l < L; ++l)
+      busy |= left[l];
+    if (!busy)
+      break;
+
+    uint64_t land[L], pick[L], open[L], k[L];
+    for (uint_fast8_t l = 0; l < L; ++l)
+    {
+      // xoroshiro128plus::next, one step per lane
+      const uint64_t a = s0[l];
+      uint64_t c = s1[l];
+      k[l] = (a + c) >> 32;
+      c ^= a;
+      s0[l] = ((a << 24) | (a >> 40)) ^ c ^ (c << 16);
+      s1[l] = (c << 37) | (c >> 27);
+
+      land[l] = landing(mask[l]);
+      open[l] = 0;
+      pick[l] = 0;
+    }
+    if constexpr (policy == Policy::heavy)
+      for (uint_fast8_t l = 0; l < L; ++l)
+        land[l] = heavyCells(cur[l], mask[l], land[l]);
+    for (uint_fast8_t col = 0; col < cols; ++col)
+      for (uint_fast8_t l = 0; l < L; ++l)
+        open[l] += (land[l] & columnMask(col)) != 0;
+    // uniform index among the open columns, then walk to that column
+    for (uint_fast8_t l = 0; l < L; ++l)
+      k[l] = (uint64_t(uint32_t(k[l])) * uint32_t(open[l])) >> 32;
+    for (uint_fast8_t col = 0; col < cols; ++col)
+      for (uint_fast8_t l = 0; l < L; ++l)
+      {
+        const uint64_t cell = land[l] & columnMask(col);
+        const uint64_t hit = cell ? ~UINT64_C(0) : 0;
+        pick[l] |= cell & (k[l] == 0 ? hit : 0);
+        k[l] -= hit & 1; // wraps past the pick, nothing else matches
+      }
+
+    for (uint_fast8_t l = 0; l < L; ++l)
+    {
+      cur[l] ^= mask[l];
+      mask[l] |= pick[l];
+      moves[l]++;
+
+      const uint64_t p = cur[l] ^ mask[l];
+      uint64_t h = p & (p >> stride);
+      uint64_t d = p & (p >> (stride - 1));
+      uint64_t a = p & (p >> (stride + 1));
+      uint64_t v = p & (p >> 1);
+      const uint64_t win = (h & (h >> (2 * stride))) | (d & (d >> (2 * (stride - 1))))
+                         | (a & (a >> (2 * (stride + 1)))) | (v & (v >> 2));
+      // same order as the scalar loop, a win on the last cell is a win
+      const bool draw = moves[l] == size && !win;
+      const bool over = draw || win;
+      const int64_t state = draw ? 0 : (moves[l] & 1 ? odd : -odd);
+      const bool counted = over && left[l];
+      acc[l] += counted ? state : 0;
+      left[l] -= counted;
+      cur[l] = over ? b.current : cur[l];
+      mask[l] = over ? b.mask : mask[l];
+      moves[l] = over ? b.totalMoves : moves[l];
+    }
+  }
+
+  int_fast64_t s = 0;
+  for (uint_fast8_t l = 0; l < L; ++l)
+  {
+    s += acc[l];
+    lanes[l].s[0] = s0[l];
+    lanes[l].s[1] = s1[l];
+  }
+  return s;
+}
+
+struct Kernel
+{
+  int_fast64_t (*run[2])(const Board&, uint_fast32_t, xoroshiro128plus*); // by policy
+  uint_fast8_t lanes;
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+template <Policy policy>
+__attribute__((target("avx512f,avx512vl,avx512bw")))
+int_fast64_t lockstepAVX512(const Board& b, uint_fast32_t games, xoroshiro128plus* lanes)
+{
+  return lockstep<16, policy>(b, games, lanes);
+}
+
+template <Policy policy>
+__attribute__((target("avx2")))
+int_fast64_t lockstepAVX2(const Board& b, uint_fast32_t games, xoroshiro128plus* lanes)
+{
+  return lockstep<8, policy>(b, games, lanes);
+}
+#endif
+
+Kernel pickKernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+      && __builtin_cpu_supports("avx512bw"))
+    return {{lockstepAVX512<Policy::uniform>, lockstepAVX512<Policy::heavy>}, 16};
+  if (__builtin_cpu_supports("avx2"))
+    return {{lockstepAVX2<Policy::uniform>, lockstepAVX2<Policy::heavy>}, 8};
+#endif
+  return {{nullptr, nullptr}, 1};
+}
+
+const Kernel kernel = pickKernel();
+}
+
+int_fast32_t playoutsScalar(const Board& b, uint_fast32_t games, xoroshiro128plus& prng, Policy policy)
+{
+  int_fast32_t s = 0;
+  for (uint_fast32_t i = 0; i < games; ++i)
+  {
+    Board copy(b);
+    while (!copy.isWin() && !copy.isDraw())
+    {
+      uint_fast8_t legal = copy.legalMoves();
+      if (policy == Policy::heavy)
+        legal = columnsOf(heavyCells(copy.current, copy.mask, landing(copy.mask)));
+      copy.dropPiece(nthMove(legal, prng.below(moveCount(legal))));
+    }
+    s += copy.state;
+  }
+  return s;
+}
+
+int_fast32_t playoutsBatched(const Board& b, uint_fast32_t games, xoroshiro128plus* lanes, Policy policy)
+{
+  Board copy(b);
+  if (copy.isWin() || copy.isDraw()) // nothing left to play
+    return copy.state * int_fast32_t(games);
+  if (kernel.lanes == 1)
+    return playoutsScalar(b, games, lanes[0], policy);
+  return kernel.run[uint_fast8_t(policy)](b, games, lanes);
+}
+
+uint_fast8_t playoutLanes()
+{
+  return kernel.lanes;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include "board.h"
+#include "xoroshiro128plus.h"
+
+// Random playouts from b. Both return the sum of Board::state over the
+// finished games, so +games means every game went to ogTurn.
+
+// how a playout picks its moves
+enum class Policy : uint_fast8_t
+{
+  uniform, // any legal move
+  // a win when there is one, else a block of the opponent's win, else a
+  // move that doesn't let them win on top of it; the same threat masks
+  // as the solver, costlier per move but the games look like real ones
+  heavy
+};
+
+// one game at a time, each move drawn from the legal-move mask
+int_fast32_t playoutsScalar(const Board& b, uint_fast32_t games, xoroshiro128plus& prng,
+                            Policy policy = Policy::uniform);
+// lanes fill two vector registers per array, the second set of games
+// hides the latency of the first and measured faster than one register
+constexpr uint_fast8_t maxLanes = 16;
+
+// many games in lockstep, one per vector lane, with branch-free move
+// picking and win tests; runs the widest kernel the CPU supports
+// lanes holds a stream per lane, maxLanes of them, advanced in place
+int_fast32_t playoutsBatched(const Board& b, uint_fast32_t games, xoroshiro128plus* lanes,
+                             Policy policy = Policy::uniform);
+// lanes playoutsBatched runs with here, 1 when it falls back to scalar
+uint_fast8_t playoutLanes();
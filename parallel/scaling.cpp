@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "mcts.h"
+#include "threadpool.h"
+
+// scaling [--csv | --json] [--ms n] [--max-threads n] [--sim iter threads]
+// searches a fixed set of positions for ms each with 1, 2, 4 ... max-threads
+// workers, in both parallel modes, and reports throughput, efficiency
+// against one worker and the share of worker time lost waiting on the pool
+namespace
+{
+struct Position
+{
+  const char* name;
+  std::vector<uint_fast8_t> moves;
+};
+
+struct Row
+{
+  std::string position;
+  std::string mode;
+  unsigned threads; // asked for
+  unsigned workers; // what the search ran with after clamping to the cores
+  double seconds;
+  double playouts; // per second
+  double nodes; // made per second
+  double iterations; // per second
+  double efficiency; // playouts against workers times the one-worker run
+  double poolLock; // share of worker time waiting for the pool's queue
+};
+
+Row measure(const Position& pos, Parallelism mode, unsigned threads, std::chrono::milliseconds time,
+            uint_fast32_t simIter, uint_fast8_t simThreads)
+{
+  Board b;
+  for (uint_fast8_t move : pos.moves)
+    b.dropPiece(move);
+  MCTS m(b);
+  m.seed = 1;
+  m.earlyStop = false;
+  m.mode = mode;
+  m.threads = threads;
+  ThreadPool& pool = *m.pool;
+
+  uint_fast64_t poolWait = pool.lockWait;
+  auto start = std::chrono::steady_clock::now();
+  m.runFor(time, simIter, simThreads);
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // an ensemble's other trees keep their own counts; nodes are the ones
+  // made, not the arena blocks claimed for them
+  uint_fast64_t playouts = m.playouts;
+  uint_fast64_t iterations = m.iterations;
+  uint_fast64_t made = m.made;
+  for (const std::unique_ptr<MCTS>& tree : m.ensemble)
+  {
+    playouts += tree->playouts;
+    iterations += tree->iterations;
+    made += tree->made;
+  }
+
+  Row row;
+  row.position = pos.name;
+  row.mode = mode == Parallelism::sharedTree ? "shared" : "ensemble";
+  row.threads = threads;
+  row.workers = m.workerCount();
+  row.seconds = secs;
+  row.playouts = playouts / secs;
+  row.nodes = made / secs;
+  row.iterations = iterations / secs;
+  double busy = secs * 1e9 * row.workers;
+  row.poolLock = (pool.lockWait - poolWait) / busy;
+  return row;
+}
+
+void print(const std::vector<Row>& rows, const std::string& format)
+{
+  if (format == "csv")
+  {
+    std::cout << "position,mode,threads,workers,seconds,playouts_per_s,nodes_per_s,"
+                 "iterations_per_s,efficiency,pool_lock\n";
+    for (const Row& r : rows)
+      std::cout << r.position << ',' << r.mode << ',' << r.threads << ',' << r.workers << ','
+                << r.seconds << ',' << r.playouts << ',' << r.nodes << ',' << r.iterations << ','
+                << r.efficiency << ',' << r.poolLock << "\n";
+  }
+  else if (format == "json")
+  {
+    std::cout << "{\n  \"cores\": " << std::thread::hardware_concurrency() << ",\n  \"runs\": [";
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+      const Row& r = rows[i];
+      std::cout << (i ? ",\n" : "\n") << "    {\"position\": \"" << r.position << "\", \"mode\": \""
+                << r.mode << "\", \"threads\": " << r.threads << ", \"workers\": " << r.workers
+                << ", \"seconds\": " << r.seconds << ", \"playouts_per_s\": " << r.playouts
+                << ", \"nodes_per_s\": " << r.nodes << ", \"iterations_per_s\": " << r.iterations
+                << ", \"efficiency\": " << r.efficiency << ", \"pool_lock\": " << r.poolLock << "}";
+    }
+    std::cout << "\n  ]\n}\n";
+  }
+  else
+  {
+    std::cout << std::left << std::setw(9) << "position" << std::setw(10) << "mode" << std::right
+              << std::setw(8) << "threads" << std::setw(8) << "workers" << std::setw(14) << "playouts/s"
+              << std::setw(12) << "nodes/s" << std::setw(8) << "eff" << std::setw(10) << "pool lk%"
+              << "\n";
+    for (const Row& r : rows)
+      std::cout << std::left << std::setw(9) << r.position << std::setw(10) << r.mode << std::right
+                << std::setw(8) << r.threads << std::setw(8) << r.workers << std::fixed
+                << std::setprecision(0) << std::setw(14) << r.playouts << std::setw(12) << r.nodes
+                << std::setprecision(2) << std::setw(8) << r.efficiency << std::setw(10)
+                << r.poolLock * 100 << "\n";
+  }
+}
+}
+
+int main(int argc, char** argv)
+{
+  std::string format = "table";
+  std::chrono::milliseconds time(1000);
+  unsigned maxThreads = std::thread::hardware_concurrency();
+  uint_fast32_t simIter = 333;
+  uint_fast8_t simThreads = 3;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--csv" || arg == "--json")
+      format = arg.substr(2);
+    else if (arg == "--ms" && i + 1 < argc)
+      time = std::chrono::milliseconds(std::atoi(argv[++i]));
+    else if (arg == "--max-threads" && i + 1 < argc)
+      maxThreads = std::atoi(argv[++i]);
+    else if (arg == "--sim" && i + 2 < argc)
+    {
+      simIter = std::atoi(argv[++i]);
+      simThreads = std::atoi(argv[++i]);
+    }
+    else
+    {
+      std::cerr << "usage: scaling [--csv | --json] [--ms n] [--max-threads n] [--sim iter threads]\n";
+      return 1;
+    }
+  }
+  if (maxThreads < 1)
+    maxThreads = 1;
+
+  std::vector<unsigned> counts;
+  for (unsigned t = 1; t < maxThreads; t *= 2)
+    counts.push_back(t);
+  counts.push_back(maxThreads);
+
+  const std::vector<Position> positions = {
+    {"empty", {}},
+    {"opening", {3, 3, 2}},
+    {"midgame", {3, 3, 3, 2, 2, 4, 4, 1, 0, 6, 5, 5}},
+  };
+  std::vector<Row> rows;
+  for (const Position& pos : positions)
+    for (Parallelism mode : {Parallelism::sharedTree, Parallelism::ensemble})
+    {
+      double base = 0;
+      for (unsigned t : counts)
+      {
+        Row row = measure(pos, mode, t, time, simIter, simThreads);
+        if (t == 1)
+          base = row.playouts;
+        row.efficiency = base > 0 ? row.playouts / (base * row.workers) : 0;
+        rows.push_back(row);
+      }
+    }
+
+  print(rows, format);
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include <atomic>
+#include <cstdint>
+
+#include "solver.h"
+
+namespace
+{
+// the lowest score negamax can return, a loss at the earliest; bounds are
+// stored above it so an empty slot reads as none
+constexpr int_fast8_t minScore = -int_fast8_t(size) / 2 + 3;
+
+// moves that don't hand the opponent a win next turn, none when they
+// have two threats to play at once
+uint64_t nonLosing(uint64_t current, uint64_t mask)
+{
+  uint64_t moves = landing(mask);
+  uint64_t threats = winningCells(current ^ mask, mask);
+  uint64_t forced = moves & threats;
+  if (forced)
+  {
+    if (forced & (forced - 1))
+      return 0;
+    moves = forced;
+  }
+  return moves & ~(threats >> 1); // don't play under their winning cell
+}
+
+// the moves of one position, handed out best score first and, among
+// equal scores, last added first
+struct Sorter
+{
+  uint_fast8_t size = 0;
+  struct
+  {
+    uint64_t move;
+    uint_fast8_t score;
+  } entries[cols];
+
+  void add(uint64_t move, uint_fast8_t score)
+  {
+    uint_fast8_t pos = size++;
+    for (; pos && entries[pos - 1].score > score; --pos)
+      entries[pos] = entries[pos - 1];
+    entries[pos] = {move, score};
+  }
+  uint64_t next()
+  {
+    return size ? entries[--size].move : 0;
+  }
+};
+}
+
+Solver::Solver(uint_fast8_t bits) : bits(bits), table(new std::atomic<uint64_t>[UINT64_C(1) << bits])
+{
+  for (uint64_t i = 0; i < UINT64_C(1) << bits; ++i)
+    table[i].store(0, std::memory_order_relaxed);
+}
+
+int_fast8_t Solver::solve(const Board& b, bool weak)
+{
+  const uint_fast8_t moves = b.totalMoves;
+  if (winningCells(b.current, b.mask) & landing(b.mask))
+    return weak ? 1 : (size + 1 - moves) / 2;
+
+  int_fast8_t min = -(size - moves) / 2;
+  int_fast8_t max = (size + 1 - moves) / 2;
+  if (weak)
+  {
+    min = -1;
+    max = 1;
+  }
+  while (min < max)
+  {
+    // halve the window, but try near a draw first since most lines end there
+    int_fast8_t med = min + (max - min) / 2;
+    if (med <= 0 && min / 2 < med)
+      med = min / 2;
+    else if (med >= 0 && max / 2 > med)
+      med = max / 2;
+    int_fast8_t r = negamax(b.current, b.mask, moves, med, med + 1);
+    if (r <= med)
+      max = r;
+    else
+      min = r;
+  }
+  if (weak) // the last pass may overshoot the window
+    return (min > 0) - (min < 0);
+  return min;
+}
+
+// the player to move can't win at once, solve() and the move filter see to it
+int_fast8_t Solver::negamax(uint64_t current, uint64_t mask, uint_fast8_t moves, int_fast8_t alpha,
+                            int_fast8_t beta)
+{
+  const uint64_t next = nonLosing(current, mask);
+  if (!next)
+    return -(size - moves) / 2;
+  if (moves >= size - 2) // neither of the last two stones can win
+    return 0;
+
+  int_fast8_t min = -(size - 2 - moves) / 2; // they can't win before our next move
+  if (alpha < min)
+  {
+    alpha = min;
+    if (alpha >= beta)
+      return alpha;
+  }
+  const uint64_t key = current + mask; // unique, the sum carries into the first empty cell
+  std::atomic<uint64_t>& slot = table[key * UINT64_C(0x9e3779b97f4a7c15) >> (64 - bits)];
+  const uint64_t entry = slot.load(std::memory_order_relaxed);
+  int_fast8_t max = (size - 1 - moves) / 2; // we can't win at once
+  if (entry >> 8 == key && entry & 0xff)
+    max = int_fast8_t(entry & 0xff) + minScore - 1;
+  if (beta > max)
+  {
+    beta = max;
+    if (alpha >= beta)
+      return beta;
+  }
+
+  Sorter sorter;
+  for (uint_fast8_t i = cols; i-- > 0;)
+    if (uint64_t move = next & columnMask(centreOrder[i]))
+      sorter.add(move, __builtin_popcountll(winningCells(current | move, mask)));
+  while (uint64_t move = sorter.next())
+  {
+    int_fast8_t score = -negamax(current ^ mask, mask | move, moves + 1, -beta, -alpha);
+    if (score >= beta)
+      return score;
+    if (score > alpha)
+      alpha = score;
+  }
+  slot.store(key << 8 | uint64_t(alpha - minScore + 1), std::memory_order_relaxed);
+  return alpha;
+}
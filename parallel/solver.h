@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "board.h"
+
+// Exact negamax for the last few empty cells, which the search solves
+// instead of playing out. Alpha-beta on the bitboards, moves that make the
+// most threats first and centre first among equals, and a table of upper
+// bounds shared by every worker. The score is closed in by null-window
+// searches starting around a draw, each pass deepening only the lines the
+// last one couldn't settle.
+struct Solver
+{
+  Solver(uint_fast8_t bits = 18);
+  Solver(const Solver& other) = delete;
+
+  // key << 8 | bound, a slot per hash with the newest entry winning; the
+  // bounds hold for the position whatever the search, so it is never cleared
+  uint_fast8_t bits;
+  std::unique_ptr<std::atomic<uint64_t>[]> table;
+
+  // the score of b for the player to move: 0 for a draw, positive when
+  // they win, the sooner the larger, negative when they lose; weak only
+  // gives the sign and is much faster. b must not be won already
+  int_fast8_t solve(const Board& b, bool weak = false);
+  int_fast8_t negamax(uint64_t current, uint64_t mask, uint_fast8_t moves, int_fast8_t alpha, int_fast8_t beta);
+};
@@ -0,0 +1,37 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "stats.h"
+
+void SearchStats::add(const PhaseStats& worker)
+{
+  if (leaves + worker.leaves)
+    avgDepth = (avgDepth * leaves + worker.depthSum) / (leaves + worker.leaves);
+  leaves += worker.leaves;
+  for (uint_fast8_t p = 0; p < phaseCount; ++p)
+  {
+    calls[p] += worker.calls[p];
+    if (worker.timed[p])
+      seconds[p] += worker.nanos[p] * 1e-9 * worker.calls[p] / worker.timed[p];
+  }
+  idle -= worker.busy * 1e-9;
+  playouts += worker.playouts;
+  nodes += worker.nodes;
+  maxDepth = worker.maxDepth > maxDepth ? worker.maxDepth : maxDepth;
+}
+
+std::string SearchStats::json() const
+{
+  static const char* names[phaseCount] = {"select", "simulate", "backpropagate"};
+  std::ostringstream out;
+  out << "{\"workers\": " << workers << ", \"wall\": " << wall << ", \"idle\": " << idle
+      << ", \"playouts\": " << playouts
+      << ", \"playouts_per_s\": " << (wall > 0 ? playouts / wall : 0) << ", \"nodes\": " << nodes
+      << ", \"bytes_per_node\": " << bytesPerNode << ", \"max_depth\": " << maxDepth
+      << ", \"avg_depth\": " << avgDepth;
+  for (uint_fast8_t p = 0; p < phaseCount; ++p)
+    out << ", \"" << names[p] << "\": {\"calls\": " << calls[p] << ", \"seconds\": " << seconds[p] << "}";
+  out << "}";
+  return out.str();
+}
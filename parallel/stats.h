@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// built with CONNECT4_STATS the search times its phases, otherwise every
+// PhaseStats call below is empty and the compiler drops it
+#ifdef CONNECT4_STATS
+constexpr bool statsEnabled = true;
+#else
+constexpr bool statsEnabled = false;
+#endif
+
+enum class Phase : uint_fast8_t
+{
+  select,
+  simulate,
+  backpropagate,
+  count
+};
+
+constexpr uint_fast8_t phaseCount = static_cast<uint_fast8_t>(Phase::count);
+
+// one worker's counts, on cache lines of its own so workers never write
+// to a line another one is using. Reading the clock costs about as much as
+// a select() at one playout per iteration, so only one iteration in
+// sampleEvery is timed and the calls, which are all counted, scale it up.
+struct alignas(64) PhaseStats
+{
+  static constexpr uint_fast32_t sampleEvery = 16;
+
+  uint_fast64_t calls[phaseCount] = {};
+  uint_fast64_t timed[phaseCount] = {}; // calls that were timed
+  uint_fast64_t nanos[phaseCount] = {}; // spent in the timed calls
+  uint_fast64_t busy = 0; // ns inside task(), the rest of the search is idle
+  uint_fast64_t playouts = 0; // in the rewards that were backpropagated
+  uint_fast64_t nodes = 0; // arena slots, filled in per tree after the search
+  uint_fast64_t leaves = 0; // new moves whose rollouts were kept
+  uint_fast64_t depthSum = 0;
+  uint_fast32_t maxDepth = 0;
+  uint_fast32_t iteration = 0;
+  bool timing = false; // this iteration is sampled
+  std::chrono::steady_clock::time_point last; // end of the last lap
+  std::chrono::steady_clock::time_point entered;
+
+  void enter()
+  {
+    if constexpr (statsEnabled)
+      entered = std::chrono::steady_clock::now();
+  }
+  void leave()
+  {
+    if constexpr (statsEnabled)
+      busy += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - entered).count();
+  }
+  // starts an iteration and the clock for its first phase
+  void mark()
+  {
+    if constexpr (statsEnabled)
+    {
+      timing = ++iteration % sampleEvery == 0;
+      if (timing)
+        last = std::chrono::steady_clock::now();
+    }
+  }
+  // charges the time since the last mark or lap to phase
+  void lap(Phase phase)
+  {
+    if constexpr (statsEnabled)
+    {
+      uint_fast8_t p = static_cast<uint_fast8_t>(phase);
+      calls[p]++;
+      if (!timing)
+        return;
+      auto now = std::chrono::steady_clock::now();
+      timed[p]++;
+      nanos[p] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+      last = now;
+    }
+  }
+  void leaf(uint_fast32_t depth, uint_fast64_t games)
+  {
+    if constexpr (statsEnabled)
+    {
+      leaves++;
+      depthSum += depth;
+      maxDepth = depth > maxDepth ? depth : maxDepth;
+      playouts += games;
+    }
+  }
+};
+
+// the workers' PhaseStats merged at the end of a search
+struct SearchStats
+{
+  unsigned workers = 0;
+  double wall = 0; // seconds
+  double idle = 0; // worker seconds spent outside task() waiting on the others
+  uint_fast64_t calls[phaseCount] = {};
+  double seconds[phaseCount] = {}; // estimated from the timed calls
+  uint_fast64_t playouts = 0;
+  uint_fast64_t nodes = 0;
+  uint_fast32_t bytesPerNode = 0;
+  uint_fast64_t leaves = 0;
+  uint_fast32_t maxDepth = 0;
+  double avgDepth = 0;
+
+  // idle starts at workers * wall, every worker's busy time comes off it
+  void add(const PhaseStats& worker);
+  // one line of JSON, for a log with a line per move
+  std::string json() const;
+};
@@ -0,0 +1,124 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+  if (threads == 0)
+    threads = 1;
+  workers.reserve(threads);
+  for (unsigned i = 0; i < threads; ++i)
+  {
+    workers.emplace_back([this]()
+    {
+      for (;;)
+      {
+        Job job;
+        {
+          std::unique_lock<std::mutex> guard = acquire();
+          wake.wait(guard, [this]() { return stopping || !jobs.empty(); });
+          if (jobs.empty()) // stopping and drained
+            return;
+          job = std::move(jobs.front());
+          jobs.pop_front();
+        }
+        finish(job);
+      }
+    });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread& t : workers)
+    if (t.joinable())
+      t.join();
+}
+
+void ThreadPool::submit(std::function<void()> job, std::atomic<uint_fast32_t>& pending)
+{
+  {
+    std::unique_lock<std::mutex> guard = acquire();
+    jobs.push_back({std::move(job), &pending});
+  }
+  wake.notify_one();
+  finished.notify_all();
+}
+
+void ThreadPool::wait(std::atomic<uint_fast32_t>& pending)
+{
+  for (;;)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> guard = acquire();
+      auto mine = [&]()
+      {
+        for (auto it = jobs.begin(); it != jobs.end(); ++it)
+          if (it->pending == &pending)
+            return it;
+        return jobs.end();
+      };
+      auto it = mine();
+      while (it == jobs.end())
+      {
+        if (!pending.load(std::memory_order_acquire))
+          return;
+        finished.wait(guard);
+        it = mine();
+      }
+      job = std::move(*it);
+      jobs.erase(it);
+    }
+    finish(job);
+  }
+}
+
+// the count drops under the lock, so a waiter can't check it and go to
+// sleep between the drop and the wake-up
+void ThreadPool::finish(Job& job)
+{
+  job.run();
+  {
+    std::unique_lock<std::mutex> guard = acquire();
+    job.pending->fetch_sub(1, std::memory_order_release);
+  }
+  finished.notify_all();
+}
+
+unsigned ThreadPool::size() const
+{
+  return workers.size();
+}
+
+// the uncontended path is one try_lock, the clock is only read on a miss
+std::unique_lock<std::mutex> ThreadPool::acquire()
+{
+  std::unique_lock<std::mutex> guard(lock, std::try_to_lock);
+  if (!guard.owns_lock())
+  {
+    auto from = std::chrono::steady_clock::now();
+    guard.lock();
+    lockWait.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - from).count(),
+                       std::memory_order_relaxed);
+  }
+  return guard;
+}
+
+ThreadPool& ThreadPool::shared()
+{
+  static ThreadPool pool;
+  return pool;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// long-lived workers fed from one job queue, so callers never spawn threads.
+// Every job belongs to the pending counter it was submitted with, which the
+// pool counts down once the job has run; searches that share the pool only
+// ever wait on, and help with, their own jobs
+struct ThreadPool
+{
+  struct Job
+  {
+    std::function<void()> run;
+    std::atomic<uint_fast32_t>* pending;
+  };
+
+  ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+  ThreadPool(const ThreadPool& other) = delete;
+  ~ThreadPool();
+
+  std::vector<std::thread> workers;
+  std::deque<Job> jobs;
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable finished; // a job ran or was queued, for wait()
+  bool stopping = false;
+  // nanoseconds threads spent waiting for lock while another held it
+  std::atomic<uint_fast64_t> lockWait = 0;
+
+  // pending counts the job in beforehand, as one of the jobs to wait for
+  void submit(std::function<void()> job, std::atomic<uint_fast32_t>& pending);
+  // runs pending's queued jobs on the calling thread and sleeps while the
+  // rest run elsewhere, until pending drops to zero; a job may wait on jobs
+  // it submitted without deadlocking the pool
+  void wait(std::atomic<uint_fast32_t>& pending);
+  // runs job and counts it down, waking whoever waits on it
+  void finish(Job& job);
+  unsigned size() const;
+  // takes lock, charging any wait to lockWait
+  std::unique_lock<std::mutex> acquire();
+
+  // process-wide pool, one thread per core
+  static ThreadPool& shared();
+};
@@ -0,0 +1,28 @@
+#include <chrono>
+#include <cstdint>
+
+#include "board.h"
+#include "timeman.h"
+
+TimeManager::TimeManager(std::chrono::milliseconds total, std::chrono::milliseconds increment)
+  : remaining(total), increment(increment) {}
+
+std::chrono::milliseconds TimeManager::allot(uint_fast8_t totalMoves) const
+{
+  // most games end well before the board fills, so plan for two thirds of
+  // our remaining moves and never fewer than a few
+  int_fast64_t ours = (size - totalMoves + 1) / 2;
+  int_fast64_t planned = ours * 2 / 3 > 3 ? ours * 2 / 3 : 3;
+  std::chrono::milliseconds slice = remaining / planned + increment;
+  std::chrono::milliseconds most = remaining - overhead;
+  if (slice > most)
+    slice = most;
+  return slice > std::chrono::milliseconds(1) ? slice : std::chrono::milliseconds(1);
+}
+
+void TimeManager::spent(std::chrono::milliseconds used)
+{
+  remaining += increment - used;
+  if (remaining < std::chrono::milliseconds(0))
+    remaining = std::chrono::milliseconds(0);
+}
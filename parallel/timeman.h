@@ -0,0 +1,20 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// splits a game clock across our moves, for play against a clock
+struct TimeManager
+{
+  TimeManager(std::chrono::milliseconds total,
+              std::chrono::milliseconds increment = std::chrono::milliseconds(0));
+
+  std::chrono::milliseconds remaining;
+  std::chrono::milliseconds increment; // added back after every move
+  std::chrono::milliseconds overhead = std::chrono::milliseconds(20); // kept in hand per move
+
+  // time for the next move, totalMoves is the stones on the board
+  std::chrono::milliseconds allot(uint_fast8_t totalMoves) const;
+  // charges the time the move really took
+  void spent(std::chrono::milliseconds used);
+};
@@ -0,0 +1,319 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "elo.h"
+#include "mcts.h"
+#include "xoroshiro128plus.h"
+
+// tournament --a spec --b spec [--games n] [--concurrency n] [--opening plies]
+//            [--sprt elo0 elo1] [--seed n] [--out file]
+// plays engine a against engine b, many games at once, in pairs that share
+// a random opening with the colours swapped, and reports a's results
+//
+// a spec is comma separated key=value pairs, anything left out keeps the
+// engine's default:
+//   expl=0.6          exploration constant
+//   uct=ucb1          or tuned or puct, the formula expl goes into
+//   iter=500          run() iterations per legal root move
+//   ms=100            runFor() time per move instead
+//   nodes=20000       runNodes() new nodes per move instead
+//   sim=100x1         rollouts per iteration, as games x batches
+//   rollout=batched   or scalar
+//   policy=heavy      or uniform, how rollouts pick their moves
+//   eval=rollouts     or threats, how leaves are valued
+//   batch=1           leaves evaluated together
+//   mode=shared       or ensemble
+//   threads=1         search workers per engine
+//   tt=1              transposition table on or off
+//   early=1           early stop on or off
+//   solve=16          empty cells under which positions are solved, 0 never
+//   mirror=1          mirror images searched as one position
+//   prune=1           only winning, blocking and safe moves expanded
+namespace
+{
+struct Engine
+{
+  std::string spec;
+  float expl = 0; // 0 keeps the engine's own
+  Exploration exploration = Exploration::ucb1;
+  uint_fast32_t iter = 500;
+  uint_fast32_t ms = 0;
+  uint_fast64_t nodes = 0;
+  uint_fast32_t simIter = 100;
+  uint_fast8_t simThreads = 1;
+  bool batched = true;
+  Policy policy = Policy::heavy;
+  Evaluator* evaluator = &rollouts();
+  uint_fast32_t batchSize = 1;
+  Parallelism mode = Parallelism::sharedTree;
+  unsigned threads = 1; // games already run side by side
+  bool useTT = true;
+  bool earlyStop = true;
+  uint_fast8_t solveBelow = 16;
+  bool mirror = true;
+  bool prune = true;
+
+  bool parse(const std::string& text);
+  void setup(MCTS& m, uint64_t seed) const;
+  uint_fast8_t think(MCTS& m) const;
+};
+
+bool Engine::parse(const std::string& text)
+{
+  spec = text.empty() ? "defaults" : text;
+  std::stringstream in(text);
+  std::string pair;
+  while (std::getline(in, pair, ','))
+  {
+    size_t eq = pair.find('=');
+    if (eq == std::string::npos)
+      return false;
+    std::string key = pair.substr(0, eq);
+    std::string value = pair.substr(eq + 1);
+    if (key == "expl")
+      expl = std::atof(value.c_str());
+    else if (key == "uct" && (value == "ucb1" || value == "tuned" || value == "puct"))
+      exploration = value == "tuned" ? Exploration::ucb1Tuned : value == "puct" ? Exploration::puct : Exploration::ucb1;
+    else if (key == "iter")
+      iter = std::atoi(value.c_str());
+    else if (key == "ms")
+      ms = std::atoi(value.c_str());
+    else if (key == "nodes")
+      nodes = std::atoll(value.c_str());
+    else if (key == "sim")
+    {
+      size_t x = value.find('x');
+      simIter = std::atoi(value.c_str());
+      simThreads = x == std::string::npos ? 1 : std::atoi(value.c_str() + x + 1);
+    }
+    else if (key == "rollout" && (value == "batched" || value == "scalar"))
+      batched = value == "batched";
+    else if (key == "policy" && (value == "uniform" || value == "heavy"))
+      policy = value == "uniform" ? Policy::uniform : Policy::heavy;
+    else if (key == "eval" && (value == "rollouts" || value == "threats"))
+      evaluator = value == "threats" ? &threats() : &rollouts();
+    else if (key == "batch")
+      batchSize = std::atoi(value.c_str());
+    else if (key == "mode" && (value == "shared" || value == "ensemble"))
+      mode = value == "shared" ? Parallelism::sharedTree : Parallelism::ensemble;
+    else if (key == "threads")
+      threads = std::atoi(value.c_str());
+    else if (key == "tt")
+      useTT = value != "0";
+    else if (key == "early")
+      earlyStop = value != "0";
+    else if (key == "solve")
+      solveBelow = std::atoi(value.c_str());
+    else if (key == "mirror")
+      mirror = value != "0";
+    else if (key == "prune")
+      prune = value != "0";
+    else
+      return false;
+  }
+  return simIter > 0 && simThreads > 0 && batchSize > 0;
+}
+
+void Engine::setup(MCTS& m, uint64_t seed) const
+{
+  if (expl > 0)
+    m.EXPL = expl;
+  m.exploration = exploration;
+  m.batchedRollouts = batched;
+  m.policy = policy;
+  m.evaluator = evaluator;
+  m.batchSize = batchSize;
+  m.mode = mode;
+  m.threads = threads;
+  m.useTT = useTT;
+  m.earlyStop = earlyStop;
+  m.solveBelow = solveBelow;
+  m.mirror = mirror;
+  m.prune = prune;
+  m.seed = seed;
+}
+
+uint_fast8_t Engine::think(MCTS& m) const
+{
+  if (ms)
+    return m.runFor(std::chrono::milliseconds(ms), simIter, simThreads);
+  if (nodes)
+    return m.runNodes(nodes, simIter, simThreads);
+  return m.run(iter, simIter, simThreads);
+}
+
+// plays out one game, engines[0] moving first on the empty board; the
+// moves, opening included, are appended to record as digits
+// 2 when engines[0] wins, 1 for a draw, 0 when it loses
+int_fast8_t play(const Engine* engines[2], const std::vector<uint_fast8_t>& opening, uint64_t seed,
+                 std::string& record)
+{
+  Board b;
+  for (uint_fast8_t move : opening)
+  {
+    b.dropPiece(move);
+    record += char('0' + move);
+  }
+  MCTS first(b);
+  MCTS second(b);
+  MCTS* trees[2] = {&first, &second};
+  engines[0]->setup(first, seed);
+  engines[1]->setup(second, seed ^ UINT64_C(0x9e3779b97f4a7c15));
+  while (!b.isWin() && !b.isDraw())
+  {
+    uint_fast8_t move = engines[b.turn]->think(*trees[b.turn]);
+    b.dropPiece(move);
+    first.advance(move);
+    second.advance(move);
+    record += char('0' + move);
+  }
+  if (!b.isWin())
+    return 1;
+  return b.turn ? 2 : 0; // turn has passed from the winner
+}
+
+std::vector<uint_fast8_t> randomOpening(uint_fast8_t plies, uint64_t seed)
+{
+  xoroshiro128plus prng(seed);
+  Board b;
+  std::vector<uint_fast8_t> moves;
+  while (moves.size() < plies && !b.isWin() && !b.isDraw())
+  {
+    uint_fast8_t legal = b.legalMoves();
+    uint_fast8_t move = nthMove(legal, prng.below(moveCount(legal)));
+    b.dropPiece(move);
+    moves.push_back(move);
+  }
+  return moves;
+}
+
+void report(const Score& score, const Sprt* sprt)
+{
+  std::cout << std::fixed << std::setprecision(1) << "games " << score.games() << ": +"
+            << score.wins << " =" << score.draws << " -" << score.losses << "  elo "
+            << score.elo() << " +/- " << score.eloMargin();
+  if (sprt)
+    std::cout << std::setprecision(2) << "  llr " << score.llr(sprt->elo0, sprt->elo1) << " ["
+              << sprt->lower() << ", " << sprt->upper() << "]";
+  std::cout << std::endl;
+}
+}
+
+int main(int argc, char** argv)
+{
+  Engine a, b;
+  bool haveA = false, haveB = false;
+  uint_fast32_t games = 200;
+  unsigned concurrency = std::thread::hardware_concurrency();
+  uint_fast8_t openingPlies = 2;
+  Sprt sprt{0, 0};
+  bool useSprt = false;
+  uint64_t seed = 1;
+  std::string out;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool ok = true;
+    if (arg == "--a" && i + 1 < argc)
+      ok = haveA = a.parse(argv[++i]);
+    else if (arg == "--b" && i + 1 < argc)
+      ok = haveB = b.parse(argv[++i]);
+    else if (arg == "--games" && i + 1 < argc)
+      games = std::atoi(argv[++i]);
+    else if (arg == "--concurrency" && i + 1 < argc)
+      concurrency = std::atoi(argv[++i]);
+    else if (arg == "--opening" && i + 1 < argc)
+      openingPlies = std::atoi(argv[++i]);
+    else if (arg == "--sprt" && i + 2 < argc)
+    {
+      sprt.elo0 = std::atof(argv[++i]);
+      sprt.elo1 = std::atof(argv[++i]);
+      useSprt = true;
+    }
+    else if (arg == "--seed" && i + 1 < argc)
+      seed = std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--out" && i + 1 < argc)
+      out = argv[++i];
+    else
+      ok = false;
+    if (!ok)
+    {
+      std::cerr << "usage: tournament --a spec --b spec [--games n] [--concurrency n] [--opening plies]\n"
+                   "                  [--sprt elo0 elo1] [--seed n] [--out file]\n";
+      return 1;
+    }
+  }
+  if (!haveA)
+    a.parse("");
+  if (!haveB)
+    b.parse("");
+  if (concurrency < 1)
+    concurrency = 1;
+
+  std::ofstream records;
+  if (!out.empty())
+  {
+    records.open(out);
+    records << "# a: " << a.spec << "\n# b: " << b.spec << "\n"
+            << "# game, engine moving first, result for the first player, moves\n";
+  }
+
+  Score score; // a's side
+  std::mutex lock; // around score, the records and the output
+  std::atomic<uint_fast32_t> next = 0;
+  std::atomic<bool> decided = false;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> runners;
+  for (unsigned t = 0; t < concurrency; ++t)
+    runners.emplace_back([&]()
+    {
+      uint_fast32_t g;
+      while (!decided && (g = next++) < games)
+      {
+        // both games of a pair open the same way, a moves first in the even one
+        const Engine* engines[2] = {&a, &b};
+        if (g % 2)
+          std::swap(engines[0], engines[1]);
+        std::string record;
+        int_fast8_t result = play(engines, randomOpening(openingPlies, seed + g / 2),
+                                  seed * 1000003 + g, record);
+        int_fast8_t forA = g % 2 ? 2 - result : result;
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (decided)
+          break; // the test ended while this game was running
+        (forA == 2 ? score.wins : forA == 1 ? score.draws : score.losses)++;
+        if (records.is_open())
+          records << g << ' ' << (g % 2 ? 'b' : 'a') << ' '
+                  << (result == 2 ? "1-0" : result == 1 ? "1/2" : "0-1") << ' ' << record << "\n";
+        if (useSprt && sprt.verdict(score))
+          decided = true;
+        if (score.games() % 20 == 0 || decided)
+          report(score, useSprt ? &sprt : nullptr);
+      }
+    });
+  for (std::thread& t : runners)
+    t.join();
+
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "\na: " << a.spec << "\nb: " << b.spec << "\n";
+  report(score, useSprt ? &sprt : nullptr);
+  if (useSprt)
+  {
+    int_fast8_t verdict = sprt.verdict(score);
+    std::cout << "sprt: " << (verdict > 0 ? "H1 accepted" : verdict < 0 ? "H0 accepted" : "inconclusive")
+              << "\n";
+  }
+  std::cout << std::setprecision(1) << secs << "s, " << score.games() / secs * 60 << " games/min\n";
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "tt.h"
+
+TranspositionTable::TranspositionTable(uint_fast8_t bits)
+  : mask((UINT64_C(1) << bits) - 1),
+  keys(new std::atomic<uint64_t>[mask + 1]),
+  entries(new std::atomic<uint64_t>[mask + 1])
+{
+  for (uint64_t i = 0; i <= mask; ++i)
+  {
+    keys[i].store(0, std::memory_order_relaxed);
+    entries[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+// a slot is claimed before its key and node are stored, wait out that gap;
+// once the node shows, the key written before it does too
+static uint32_t published(const std::atomic<uint64_t>& entry)
+{
+  uint32_t idx;
+  while (!(idx = uint32_t(entry.load(std::memory_order_acquire))))
+    std::this_thread::yield();
+  return idx;
+}
+
+uint32_t TranspositionTable::lookup(uint64_t key) const
+{
+  for (uint_fast8_t i = 0; i < maxProbes; ++i)
+  {
+    uint64_t slot = (key + i) & mask;
+    if (entries[slot].load(std::memory_order_acquire) >> 32 != generation)
+      return 0; // empty this generation, the probe ends here
+    uint32_t idx = published(entries[slot]);
+    if (keys[slot].load(std::memory_order_relaxed) == key)
+      return idx;
+  }
+  return 0;
+}
+
+uint32_t TranspositionTable::insert(uint64_t key, uint32_t node)
+{
+  const uint64_t claimed = uint64_t(generation) << 32;
+  for (uint_fast8_t i = 0; i < maxProbes; ++i)
+  {
+    uint64_t slot = (key + i) & mask;
+    uint64_t entry = entries[slot].load(std::memory_order_acquire);
+    if (entry >> 32 != generation
+        && entries[slot].compare_exchange_strong(entry, claimed, std::memory_order_acq_rel))
+    {
+      keys[slot].store(key, std::memory_order_relaxed);
+      entries[slot].store(claimed | node, std::memory_order_release);
+      return node;
+    }
+    // someone else's this generation, perhaps ours beaten to the slot
+    uint32_t idx = published(entries[slot]);
+    if (keys[slot].load(std::memory_order_relaxed) == key)
+      return idx;
+  }
+  return 0;
+}
+
+void TranspositionTable::clear()
+{
+  if (++generation) // else every slot could pass for current again
+    return;
+  for (uint64_t i = 0; i <= mask; ++i)
+    entries[i].store(0, std::memory_order_relaxed);
+  generation = 1;
+}
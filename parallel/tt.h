@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Lock-free map from a position's zobrist key to the arena index of its
+// node, shared by every worker so transpositions land on one node.
+// Open addressing with linear probing. Every slot carries the generation
+// that filled it and anything older reads as empty, so clear() only bumps
+// the generation instead of rewriting the table on every re-root.
+struct TranspositionTable
+{
+  TranspositionTable(uint_fast8_t bits = 20);
+  TranspositionTable(const TranspositionTable& other) = delete;
+
+  static constexpr uint_fast8_t maxProbes = 32;
+
+  uint64_t mask; // slots - 1
+  uint32_t generation = 1; // 0 is never current, a fresh slot is empty
+  std::unique_ptr<std::atomic<uint64_t>[]> keys;
+  // generation << 32 | node; node 0 while the slot's key is being written
+  std::unique_ptr<std::atomic<uint64_t>[]> entries;
+
+  // 0 when the position has no node yet
+  uint32_t lookup(uint64_t key) const;
+  // publishes node for key and returns whichever node owns the key now,
+  // which is not ours when another thread got there first; 0 when the
+  // probe window is full and the position can't be shared
+  uint32_t insert(uint64_t key, uint32_t node);
+  // empties the table in O(1), only while nobody is using it
+  void clear();
+};
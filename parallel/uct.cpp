@@ -0,0 +1,22 @@
+#include <cmath>
+#include <cstdint>
+
+#include "uct.h"
+
+namespace
+{
+UctTables makeUctTables()
+{
+  UctTables t;
+  t.log[0] = 0; // a node is only scored once it has a visit
+  t.rsqrt[0] = 0;
+  for (uint_fast32_t n = 1; n < uctTableSize; ++n)
+  {
+    t.log[n] = std::log(float(n));
+    t.rsqrt[n] = 1 / std::sqrt(float(n));
+  }
+  return t;
+}
+}
+
+const UctTables uctTables = makeUctTables();
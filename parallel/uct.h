@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// The exploration formulas bestChild() can score moves with. Each is a
+// type, so the search is compiled once per formula with its arithmetic
+// inlined into one loop over every slot of a node: start() runs once per
+// node, value() once per slot, with the visits already turned into
+// 1 / sqrt(visits) by the table below. mean is a move's score per visit
+// from the mover's side, a sum over one batch of playouts, and scale turns
+// it into [-1, 1].
+
+// lookups for the parent's ln N and each move's 1 / sqrt(n) while the
+// counts are small, which is nearly always; the functions past them
+constexpr uint_fast32_t uctTableSize = 4096;
+
+struct UctTables
+{
+  float log[uctTableSize];
+  float rsqrt[uctTableSize];
+};
+
+extern const UctTables uctTables;
+
+inline float logOf(uint_fast32_t n)
+{
+  return n < uctTableSize ? uctTables.log[n] : std::log(float(n));
+}
+inline float rsqrtOf(uint_fast32_t n)
+{
+  return n < uctTableSize ? uctTables.rsqrt[n] : 1 / std::sqrt(float(n));
+}
+
+// what start() hands to value() for every slot of one node
+struct UctContext
+{
+  float explore;
+  float scale;
+  float logN;
+};
+
+// mean + c sqrt(2 ln N / n), on the raw batch sums the way the search has
+// always scored moves, so c is small next to the means
+struct UCB1
+{
+  static UctContext start(float c, uint_fast32_t parentVisits, uint_fast8_t /*count*/, float scale)
+  {
+    return {c * std::sqrt(2 * logOf(parentVisits)), scale, 0};
+  }
+  static float value(const UctContext& ctx, float mean, float rsqrt)
+  {
+    return mean + ctx.explore * rsqrt;
+  }
+};
+
+// UCB1 with the bonus narrowed by an upper bound on the move's variance;
+// a playout is won, drawn or lost, so the variance of a mean q in [-1, 1]
+// is at most (1 - q^2) / 4 and needs no second moment kept per move.
+// c = 1 is the textbook bonus, doubled for the wider range of q
+struct UCB1Tuned
+{
+  static UctContext start(float c, uint_fast32_t parentVisits, uint_fast8_t /*count*/, float scale)
+  {
+    return {c, scale, logOf(parentVisits)};
+  }
+  static float value(const UctContext& ctx, float mean, float rsqrt)
+  {
+    const float q = mean * ctx.scale;
+    const float bound = (1 - q * q) / 4 + std::sqrt(2 * ctx.logN) * rsqrt;
+    return q + 2 * ctx.explore * std::sqrt(ctx.logN * rsqrt * rsqrt * (bound < 0.25f ? bound : 0.25f));
+  }
+};
+
+// q + c P sqrt(N) / (1 + n), the prior P spread evenly over the moves
+// until an evaluator hands out better ones
+struct PUCT
+{
+  static UctContext start(float c, uint_fast32_t parentVisits, uint_fast8_t count, float scale)
+  {
+    return {c * std::sqrt(float(parentVisits)) / count, scale, 0};
+  }
+  static float value(const UctContext& ctx, float mean, float rsqrt)
+  {
+    const float n = 1 / (rsqrt * rsqrt);
+    return mean * ctx.scale + ctx.explore / (1 + n);
+  }
+};
+
+// which of the above a search uses, dispatched once per descent
+enum class Exploration : uint_fast8_t
+{
+  ucb1,
+  ucb1Tuned,
+  puct
+};
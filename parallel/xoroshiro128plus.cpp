@@ -7,10 +7,23 @@ THIS CODE IS FROM:  https://xoroshiro.di.unimi.it/xoroshiro128plusplus.c
 !!!!!!!!!!!!!!!
 */
 
+// the clock only picks the seed, splitmix spreads it over both words so
+// two generators made a tick apart are not the same stream shifted
 xoroshiro128plus::xoroshiro128plus()
+  : xoroshiro128plus(std::chrono::high_resolution_clock::now().time_since_epoch().count())
 {
-  s[0] = std::chrono::high_resolution_clock::now().time_since_epoch().count() / 10000;
-  s[1] = std::chrono::high_resolution_clock::now().time_since_epoch().count() / 10000;
+}
+
+// seeding as the authors recommend, state words from splitmix64
+xoroshiro128plus::xoroshiro128plus(uint64_t seed)
+{
+  for (uint64_t& w : s)
+  {
+    uint64_t z = (seed += UINT64_C(0x9e3779b97f4a7c15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    w = z ^ (z >> 31);
+  }
 }
 
 uint64_t xoroshiro128plus::rotl(const uint64_t x, int k)
@@ -31,14 +44,26 @@ uint64_t xoroshiro128plus::next()
 	return result;
 }
 
-/*
+uint32_t xoroshiro128plus::below(uint32_t n)
+{
+  uint64_t m = (next() >> 32) * n;
+  if (uint32_t(m) < n)
+  {
+    const uint32_t threshold = -n % n;
+    while (uint32_t(m) < threshold)
+      m = (next() >> 32) * n;
+  }
+  return m >> 32;
+}
+
+// same as 2^64 calls to next()
 void xoroshiro128plus::jump()
 {
   static const uint64_t JUMP[] = { 0xdf900294d8f554a5, 0x170865df4b3201fc };
 
 	uint64_t s0 = 0;
 	uint64_t s1 = 0;
-	for(int i = 0; i < sizeof JUMP / sizeof *JUMP; i++)
+	for(unsigned i = 0; i < sizeof JUMP / sizeof *JUMP; i++)
 		for(int b = 0; b < 64; b++) {
 			if (JUMP[i] & UINT64_C(1) << b) {
 				s0 ^= s[0];
@@ -51,13 +76,14 @@ void xoroshiro128plus::jump()
 	s[1] = s1;
 }
 
-void xoroshiro128plus::long_jump(void)
+// same as 2^96 calls to next()
+void xoroshiro128plus::long_jump()
 {
 	static const uint64_t LONG_JUMP[] = { 0xd2a98b26625eee7b, 0xdddf9b1090aa7ac1 };
 
 	uint64_t s0 = 0;
 	uint64_t s1 = 0;
-	for(int i = 0; i < sizeof LONG_JUMP / sizeof *LONG_JUMP; i++)
+	for(unsigned i = 0; i < sizeof LONG_JUMP / sizeof *LONG_JUMP; i++)
 		for(int b = 0; b < 64; b++)
 		{
 			if (LONG_JUMP[i] & UINT64_C(1) << b)
@@ -71,4 +97,3 @@ void xoroshiro128plus::long_jump(void)
 	s[0] = s0;
 	s[1] = s1;
 }
- */
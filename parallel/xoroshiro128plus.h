@@ -12,10 +12,17 @@ struct xoroshiro128plus
 {
   uint64_t s[2];
 
-  xoroshiro128plus();
+  xoroshiro128plus(); // seeded from the clock
+  explicit xoroshiro128plus(uint64_t seed);
 
   inline uint64_t rotl(const uint64_t x, int k);
   uint64_t next();
+  // uniform in [0, n) without the bias of next() % n; multiply-shift on the
+  // high half (the low bits of xoroshiro128+ are weak) and a rejection that
+  // only fires with probability n / 2^32
+  uint32_t below(uint32_t n);
+  // streams that never overlap: jump() per stream off a common start
+  // gives 2^64 numbers each, long_jump() 2^32 groups of 2^64 jumps
   void jump();
   void long_jump();
 